@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "aircraftid.h"
+
+const char* AircraftGroup = "Aircraft";
+
+struct aircraftName {
+    const char* name;
+    Aircraft aircraft;
+};
+
+// Aircraft types that can be used in settings
+const aircraftName AircraftNames[] = {
+    { "Cessna 152", CESSNA_152 },
+    { "Cessna 172", CESSNA_172 },
+    { "Cessna CJ4", CESSNA_CJ4 },
+    { "Cessna Longitude", CESSNA_LONGITUDE },
+    { "Savage Cub", SAVAGE_CUB },
+    { "Shock Ultra", SHOCK_ULTRA },
+    { "Airbus A310", AIRBUS_A310 },
+    { "FBW", FBW },
+    { "Boeing 747", BOEING_747 },
+    { "Supermarine Spitfire", SUPERMARINE_SPITFIRE }
+};
+
+struct electricsName {
+    const char* name;
+    ElectricsRule electrics;
+};
+
+const electricsName ElectricsNames[] = {
+    { "Volts", VOLTS_ELECTRICS },
+    { "Batteries", BATTERY_ELECTRICS },
+    { "Pitch Trim", PITCH_TRIM_ELECTRICS }
+};
+
+struct defaultAircraft {
+    const char* title;
+    const char* contains;
+    aircraftEntry entry;
+};
+
+// Used if there is no "Aircraft" group in the settings file
+const defaultAircraft DefaultAircraft[] = {
+    { NULL, "A31", { AIRBUS_A310, -1, PITCH_TRIM_ELECTRICS } },
+    { NULL, "A32", { FBW, -1, BATTERY_ELECTRICS } },
+    { NULL, "A38", { FBW, -1, BATTERY_ELECTRICS } },
+    { "Cessna 152", NULL, { CESSNA_152, -1, VOLTS_ELECTRICS } },
+    { "Cessna Skyhawk", NULL, { CESSNA_172, -1, VOLTS_ELECTRICS } },
+    { "Cessna CJ4", NULL, { CESSNA_CJ4, -1, VOLTS_ELECTRICS } },
+    { "Cessna Longitude", NULL, { CESSNA_LONGITUDE, -1, VOLTS_ELECTRICS } },
+    { "Asobo Savage Cub", NULL, { SAVAGE_CUB, -1, VOLTS_ELECTRICS } },
+    { "Savage Shock Ultra", NULL, { SHOCK_ULTRA, -1, VOLTS_ELECTRICS } },
+    { "Boeing 747-8", NULL, { BOEING_747, -1, VOLTS_ELECTRICS } },
+    { "Salty Boeing 747", NULL, { BOEING_747, -1, VOLTS_ELECTRICS } },
+    { "FlyingIron Spitfire", NULL, { SUPERMARINE_SPITFIRE, -1, VOLTS_ELECTRICS } }
+};
+
+///
+/// Identifies the loaded aircraft from its title.
+///
+/// Aircraft are listed in the "Aircraft" group of the settings file
+/// so new ones can be added without rebuilding, e.g.
+///
+///   "Aircraft": [
+///     { "Title": "Cessna Skyhawk", "Type": "Cessna 172" },
+///     { "Contains": "A32", "Type": "FBW", "Electrics": "Batteries", "Airliner": 1 }
+///   ]
+///
+/// Title matches the start of the aircraft title and Contains
+/// matches anywhere in it. Contains is checked first and the
+/// longest Title wins. Electrics is Volts (default), Batteries or
+/// Pitch Trim. If Airliner is missing the cruise speed decides.
+///
+/// All the text is held in two tries so the title only has to be
+/// scanned once. Identification only runs when the data link sees
+/// the title change.
+///
+
+aircraftid::aircraftid()
+{
+    // Root nodes
+    prefixTrie.push_back({ '\0', -1, -1, -1 });
+    containsTrie.push_back({ '\0', -1, -1, -1 });
+
+    int index = 0;
+    while (true) {
+        char indexStr[16];
+        sprintf(indexStr, "%d", index);
+        const char* groupPath[2] = { AircraftGroup, indexStr };
+
+        const char* title = globals.allSettings->getString(globals.allSettings->find(groupPath, 2, "Title"));
+        const char* contains = globals.allSettings->getString(globals.allSettings->find(groupPath, 2, "Contains"));
+        const char* type = globals.allSettings->getString(globals.allSettings->find(groupPath, 2, "Type"));
+        if (!title && !contains && !type) {
+            break;
+        }
+
+        aircraftEntry entry = { OTHER_AIRCRAFT, -1, VOLTS_ELECTRICS };
+
+        bool found = false;
+        for (const aircraftName& aircraftName : AircraftNames) {
+            if (type && strcmp(type, aircraftName.name) == 0) {
+                entry.aircraft = aircraftName.aircraft;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            printf("Invalid aircraft type specified for %s/%d\n", AircraftGroup, index);
+            exit(1);
+        }
+
+        const char* electrics = globals.allSettings->getString(globals.allSettings->find(groupPath, 2, "Electrics"));
+        if (electrics) {
+            found = false;
+            for (const electricsName& electricsName : ElectricsNames) {
+                if (strcmp(electrics, electricsName.name) == 0) {
+                    entry.electrics = electricsName.electrics;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                printf("Invalid electrics specified for %s/%d\n", AircraftGroup, index);
+                exit(1);
+            }
+        }
+
+        int airliner = globals.allSettings->getInt(globals.allSettings->find(groupPath, 2, "Airliner"));
+        if (airliner != INT_MIN) {
+            entry.airliner = airliner != 0;
+        }
+
+        if ((!title || !*title) && (!contains || !*contains)) {
+            printf("No Title or Contains specified for %s/%d\n", AircraftGroup, index);
+            exit(1);
+        }
+
+        addEntry(title, contains, entry);
+        index++;
+    }
+
+    if (index == 0) {
+        for (const defaultAircraft& aircraft : DefaultAircraft) {
+            addEntry(aircraft.title, aircraft.contains, aircraft.entry);
+        }
+    }
+}
+
+void aircraftid::addEntry(const char* title, const char* contains, aircraftEntry entry)
+{
+    int entryNum = entries.size();
+    entries.push_back(entry);
+
+    if (title && *title) {
+        addText(prefixTrie, title, entryNum);
+    }
+    if (contains && *contains) {
+        addText(containsTrie, contains, entryNum);
+    }
+}
+
+/// <summary>
+/// Adds the text to the trie. If the same text is added
+/// twice the first entry is kept.
+/// </summary>
+void aircraftid::addText(std::vector<titleNode>& trie, const char* text, int entry)
+{
+    int node = 0;
+
+    for (const char* ch = text; *ch != '\0'; ch++) {
+        int next = trie[node].child;
+        while (next != -1 && trie[next].ch != *ch) {
+            next = trie[next].sibling;
+        }
+
+        if (next == -1) {
+            next = trie.size();
+            trie.push_back({ *ch, -1, trie[node].child, -1 });
+            trie[node].child = next;
+        }
+        node = next;
+    }
+
+    if (trie[node].entry == -1) {
+        trie[node].entry = entry;
+    }
+}
+
+/// <summary>
+/// Returns the entry of the longest text in the trie that
+/// the given text starts with (-1 if none).
+/// </summary>
+int aircraftid::matchText(const std::vector<titleNode>& trie, const char* text)
+{
+    int node = 0;
+    int entry = -1;
+
+    for (const char* ch = text; *ch != '\0'; ch++) {
+        node = trie[node].child;
+        while (node != -1 && trie[node].ch != *ch) {
+            node = trie[node].sibling;
+        }
+
+        if (node == -1) {
+            break;
+        }
+        if (trie[node].entry != -1) {
+            entry = trie[node].entry;
+        }
+    }
+
+    return entry;
+}
+
+/// <summary>
+/// Called by the data link when the aircraft title changes.
+/// </summary>
+void aircraftid::identify(const char* title)
+{
+    int entry = -1;
+
+    for (const char* pos = title; *pos != '\0' && entry == -1; pos++) {
+        entry = matchText(containsTrie, pos);
+    }
+
+    if (entry == -1) {
+        entry = matchText(prefixTrie, title);
+    }
+
+    if (entry != -1) {
+        publishAircraft(entries[entry].aircraft, entries[entry].airliner, entries[entry].electrics);
+        return;
+    }
+
+    // Need to flip between other aircraft so that instruments
+    // can detect the aircraft has changed.
+    if (currentAircraft().aircraft == OTHER_AIRCRAFT) {
+        publishAircraft(OTHER_AIRCRAFT2, -1, VOLTS_ELECTRICS);
+    }
+    else {
+        publishAircraft(OTHER_AIRCRAFT, -1, VOLTS_ELECTRICS);
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef _AIRCRAFTID_H_
+#define _AIRCRAFTID_H_
+
+#include <vector>
+#include "globals.h"
+
+extern globalVars globals;
+
+struct aircraftEntry {
+    Aircraft aircraft;
+    int airliner;               // 1 = airliner, 0 = not, -1 = decide from cruise speed
+    ElectricsRule electrics;
+};
+
+// Character in a trie of title text
+struct titleNode {
+    char ch;
+    int child;      // First node of next character (-1 = none)
+    int sibling;    // Next alternative for this character (-1 = none)
+    int entry;      // Aircraft if text ends here (-1 = none)
+};
+
+class aircraftid
+{
+private:
+    std::vector<aircraftEntry> entries;
+    std::vector<titleNode> prefixTrie;      // Matched against start of title
+    std::vector<titleNode> containsTrie;    // Matched anywhere in title
+
+public:
+    aircraftid();
+    void identify(const char* title);
+
+private:
+    void addEntry(const char* title, const char* contains, aircraftEntry entry);
+    void addText(std::vector<titleNode>& trie, const char* text, int entry);
+    int matchText(const std::vector<titleNode>& trie, const char* text);
+};
+
+#endif // _AIRCRAFTID_H_
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "aircraftprofile.h"
+
+void a310SpeedMode(SimVars* simVars, bool* managedSpeed, bool* showMach);
+void fbwSpeedMode(SimVars* simVars, bool* managedSpeed, bool* showMach);
+
+// FBW A32NX uses its own FCU events. Approach is a single push
+// so is only sent if it changes the mode.
+constexpr eventRule FbwRules[] = {
+    { KEY_AP_HDG_HOLD_OFF, { 1, { { A32NX_FCU_HDG_PUSH, Always, true } } } },
+    { KEY_AP_HDG_HOLD_ON, { 1, { { A32NX_FCU_HDG_PULL, Always, true } } } },
+    { KEY_AP_ALT_HOLD_OFF, { 1, { { A32NX_FCU_ALT_PUSH, Always, true } } } },
+    { KEY_AP_ALT_HOLD_ON, { 1, { { A32NX_FCU_ALT_PULL, Always, true } } } },
+    { KEY_AP_VS_VAR_SET_ENGLISH, { 3, {
+        { A32NX_FCU_VS_PUSH, ValueZero, false },
+        { A32NX_FCU_VS_PULL, ValueNonZero, false },
+        { A32NX_FCU_VS_SET, Always, true } } } },
+    { KEY_AP_APR_HOLD_OFF, { 1, { { A32NX_FCU_APPR_PUSH, ApprModeOn, true } } } },
+    { KEY_AP_APR_HOLD_ON, { 1, { { A32NX_FCU_APPR_PUSH, ApprModeOff, true } } } },
+    { KEY_HEADING_BUG_SET, { 2, {
+        { KEY_HEADING_BUG_SET, Always, true },
+        { A32NX_FCU_HDG_SET, Always, true } } } },
+    { KEY_AP_MACH_VAR_SET, { 1, { { A32NX_FCU_SPD_SET, Always, true } } } },
+    { KEY_AP_SPD_VAR_SET, { 1, { { A32NX_FCU_SPD_SET, Always, true } } } },
+    { KEY_AP_SPEED_SLOT_INDEX_SET, { 2, {
+        { A32NX_FCU_SPD_PUSH, ValueManaged, true },
+        { A32NX_FCU_SPD_PULL, ValueSelected, true } } } },
+    { KEY_AP_HEADING_SLOT_INDEX_SET, { 2, {
+        { A32NX_FCU_HDG_PUSH, ValueManaged, true },
+        { A32NX_FCU_HDG_PULL, ValueSelected, true } } } },
+    { KEY_AP_VS_SLOT_INDEX_SET, { 2, {
+        { A32NX_FCU_ALT_PUSH, ValueManaged, true },
+        { A32NX_FCU_ALT_PULL, ValueSelected, true } } } }
+};
+static_assert(validRules(FbwRules), "Invalid FBW event rules");
+
+constexpr eventTable FbwEvents = makeEventTable(FbwRules);
+
+///
+/// Everything the autopilot does differently for a particular
+/// aircraft. A profile is looked up once when the aircraft is
+/// loaded so the autopilot only has to test a flag or make a
+/// single call rather than check which aircraft it is.
+///
+/// To support a new aircraft add an entry to the table. Aircraft
+/// without an entry use the default profile. Aircraft that use
+/// their own events have a table of rules built at compile time.
+///
+
+const aircraftProfile DefaultProfile = { OTHER_AIRCRAFT, 0, NULL, NULL };
+
+const aircraftProfile Profiles[] = {
+    { AIRBUS_A310,
+        ProfileKeepManaged | ProfileManagedReadouts | ProfileMachAsSpeed | ProfileConvertMach |
+        ProfileNoCapture | ProfileEngageArms | ProfileAthrSelects | ProfileVsSetOnSelect | ProfileVsDashes,
+        a310SpeedMode, NULL },
+    { FBW,
+        ProfileKeepManaged | ProfileManagedReadouts | ProfileMachToggle | ProfileVsPushTrkFpa,
+        fbwSpeedMode, &FbwEvents },
+    { BOEING_747,
+        ProfileKeepManaged | ProfileVsForceManSel,
+        NULL, NULL },
+    { CESSNA_LONGITUDE,
+        ProfileEngageArms,
+        NULL, NULL }
+};
+
+const aircraftProfile* findProfile(Aircraft aircraft)
+{
+    for (const aircraftProfile& profile : Profiles) {
+        if (profile.aircraft == aircraft) {
+            return &profile;
+        }
+    }
+
+    return &DefaultProfile;
+}
+
+void a310SpeedMode(SimVars* simVars, bool* managedSpeed, bool* showMach)
+{
+    *managedSpeed = simVars->jbManagedSpeed;
+    *showMach = simVars->jbShowMach != 0;
+}
+
+void fbwSpeedMode(SimVars* simVars, bool* managedSpeed, bool* showMach)
+{
+    *managedSpeed = simVars->jbManagedSpeed;
+    *showMach = simVars->jbAutothrustMode == 8;
+}
+
+/// <summary>
+/// Returns true if a translated write should be sent for this value.
+/// </summary>
+bool writeWanted(writeCondition when, SimVars* simVars, double value)
+{
+    switch (when) {
+    case ValueManaged:
+        return value == 2;
+    case ValueSelected:
+        return value != 2;
+    case ValueZero:
+        return value == 0;
+    case ValueNonZero:
+        return value != 0;
+    case ApprModeOn:
+        return simVars->jbApprMode != 0;
+    case ApprModeOff:
+        return simVars->jbApprMode != 1;
+    default:
+        return true;
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef _AIRCRAFTPROFILE_H_
+#define _AIRCRAFTPROFILE_H_
+
+#include "simvars.h"
+
+// Behaviour flags
+const int ProfileKeepManaged = 0x001;       // Managed modes kept when aircraft is loaded
+const int ProfileManagedReadouts = 0x002;   // Managed heading and altitude read from sim
+const int ProfileMachAsSpeed = 0x004;       // Mach is set with the speed event
+const int ProfileConvertMach = 0x008;       // Speed converted when swapping knots and mach
+const int ProfileMachToggle = 0x010;        // Knots/mach swap pushed to FCU
+const int ProfileNoCapture = 0x020;         // Don't capture values when autopilot engaged
+const int ProfileEngageArms = 0x040;        // Engaging autopilot arms autothrottle and FD
+const int ProfileAthrSelects = 0x080;       // Arming autothrottle selects 210 knots
+const int ProfileVsSetOnSelect = 0x100;     // Selecting V/S sends V/S set
+const int ProfileVsForceManSel = 0x200;     // Selecting V/S swaps managed/selected altitude
+const int ProfileVsPushTrkFpa = 0x400;      // V/S push toggles HDG V/S and TRK FPA
+const int ProfileVsDashes = 0x800;          // V/S dashes unless altitude managed (selected V/S)
+
+// Reads managed speed and knots/mach from the sim
+typedef void (*speedModeReader)(SimVars* simVars, bool* managedSpeed, bool* showMach);
+
+const int EventCount = SIM_STOP + 1;
+const int MaxEventWrites = 3;
+
+// When a translated write is sent
+enum writeCondition {
+    Always,
+    ValueManaged,       // Value is 2 (managed slot)
+    ValueSelected,      // Value is not 2 (selected slot)
+    ValueZero,
+    ValueNonZero,
+    ApprModeOn,         // Approach mode is not off
+    ApprModeOff         // Approach mode is not on
+};
+
+struct eventWrite {
+    EVENT_ID id;
+    writeCondition when;
+    bool withValue;     // Send the original value (else 0)
+};
+
+// Writes to be made in place of a standard event
+struct eventTranslation {
+    int writeCount;     // 0 = not translated (sent as is)
+    eventWrite writes[MaxEventWrites];
+};
+
+struct eventRule {
+    EVENT_ID from;
+    eventTranslation to;
+};
+
+// Translation of every event indexed by EVENT_ID
+struct eventTable {
+    eventTranslation events[EventCount];
+};
+
+struct aircraftProfile {
+    Aircraft aircraft;
+    int flags;
+    speedModeReader readSpeedMode;      // NULL = not read from sim
+    const eventTable* events;           // NULL = standard events
+};
+
+const aircraftProfile* findProfile(Aircraft aircraft);
+bool writeWanted(writeCondition when, SimVars* simVars, double value);
+
+/// <summary>
+/// Returns true if every rule translates a different event and
+/// only writes valid events.
+/// </summary>
+template<int N>
+constexpr bool validRules(const eventRule (&rules)[N])
+{
+    for (int i = 0; i < N; i++) {
+        const eventRule& rule = rules[i];
+        if (rule.from <= SIM_START || rule.from >= SIM_STOP) {
+            return false;
+        }
+        if (rule.to.writeCount < 1 || rule.to.writeCount > MaxEventWrites) {
+            return false;
+        }
+        for (int w = 0; w < rule.to.writeCount; w++) {
+            if (rule.to.writes[w].id <= SIM_START || rule.to.writes[w].id >= SIM_STOP) {
+                return false;
+            }
+        }
+        for (int j = 0; j < i; j++) {
+            if (rules[j].from == rule.from) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Spreads the rules into a table indexed by EVENT_ID.
+/// </summary>
+template<int N>
+constexpr eventTable makeEventTable(const eventRule (&rules)[N])
+{
+    eventTable table = {};
+    for (int i = 0; i < N; i++) {
+        table.events[rules[i].from] = rules[i].to;
+    }
+
+    return table;
+}
+
+#endif // _AIRCRAFTPROFILE_H_
@@ -6,10 +6,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
-#include <wiringPi.h>
+#include "hardware.h"
 #include "gpioctrl.h"
 #include "globals.h"
 #include "settings.h"
+#include "realtime.h"
+#include "hotreload.h"
+#include "inputqueue.h"
+#include "switchbox.h"
+#include "timerwheel.h"
 #include "simvars.h"
 #include "autopilot.h"
 
@@ -25,13 +30,20 @@ autopilot* ap;
 /// </summary>
 void init(const char *settingsFile = NULL)
 {
-    // Init wiringPi ourselves as it is needed by both
+    globals.allSettings = new settings(settingsFile);
+
+    // Init hardware ourselves as it is needed by both
     // gpioCtrl and sevenSegment.
-    wiringPiSetupGpio();
+    globals.hw = createHardware();
+    globals.hw->setup();
 
-    globals.allSettings = new settings(settingsFile);
+    globals.realTime = new realtime();
+    globals.inputQueue = new inputqueue();
+    globals.switchBox = new switchbox();
+    globals.timerWheel = new timerwheel();
     globals.simVars = new simvars();
     globals.gpioCtrl = new gpioctrl(false);
+    globals.hotReload = new hotreload();
 }
 
 /// <summary>
@@ -42,13 +54,14 @@ void updateCommon()
     SimVars* simVars = &globals.simVars->simVars;
 
     // Electrics check
-    if (globals.aircraft == FBW) {
+    ElectricsRule electricsRule = currentAircraft().electricsRule;
+    if (electricsRule == BATTERY_ELECTRICS) {
         // Autopilot only comes on if both batteries on or
         // have external power, APU or main engines running.
         globals.electrics = globals.connected && (simVars->dcVolts > 25.4 ||
             (simVars->elecBat1 > 0 && simVars->elecBat2 > 0));
     }
-    else if (globals.aircraft == AIRBUS_A310) {
+    else if (electricsRule == PITCH_TRIM_ELECTRICS) {
         // Autopilot does not work until pitch trim on (and pitch trim switches off if ADIRS not aligned)
         globals.electrics = globals.connected && simVars->batteryLoad < 0 && simVars->jbPitchTrim != 0;
     }
@@ -60,13 +73,35 @@ void updateCommon()
     globals.avionics = globals.connected && (simVars->com1Status == 0 || simVars->com2Status == 0);
 }
 
+/// <summary>
+/// Checks the settings of every subsystem that can be reloaded
+/// so an invalid value in any of them keeps all current settings.
+/// </summary>
+bool checkSettings()
+{
+    return globals.simVars->checkSettings() && globals.gpioCtrl->checkSettings() && ap->checkLayout();
+}
+
 /// <summary>
 /// Update everything before the next frame
 /// </summary>
 void doUpdate()
 {
+    // Apply any changes to the settings file
+    int changes = globals.hotReload->takeChanges(checkSettings);
+    if (changes & ReloadDataLink) {
+        globals.simVars->reloadSettings();
+    }
+    if (changes & ReloadControls) {
+        globals.gpioCtrl->reloadSettings();
+    }
+    if (changes & ReloadLayout) {
+        ap->reloadLayout();
+    }
+
     updateCommon();
 
+    globals.timerWheel->advance();
     ap->update();
 }
 
@@ -86,13 +121,38 @@ int main(int argc, char **argv)
     }
 
     ap = new autopilot();
+    globals.realTime->configureThread("Render");
+
+    long long nextFrameUs = monotonicUs();
 
     while (!globals.quit) {
         doUpdate();
         ap->render();
 
-        // Update 10 times per second
-        usleep(100000);
+        // Update 10 times per second. Any input wakes us up
+        // early so the new value is shown straight away, as does
+        // any timer that is due before the next frame.
+        nextFrameUs += 100000;
+        while (!globals.quit) {
+            long long untilUs = globals.timerWheel->nextDueUs(nextFrameUs);
+            if (globals.inputQueue->waitForInput(untilUs)) {
+                if (!ap->fastInput()) {
+                    // Input is still queued so update now rather
+                    // than keep waking up for it.
+                    break;
+                }
+            }
+            else if (untilUs == nextFrameUs) {
+                break;
+            }
+            globals.timerWheel->advance();
+        }
+
+        // Don't try to catch up if we've fallen behind
+        long long nowUs = monotonicUs();
+        if (nextFrameUs < nowUs) {
+            nextFrameUs = nowUs;
+        }
     }
 
     return 0;
@@ -2,19 +2,49 @@
 #include <stdlib.h>
 #include <math.h>
 #include "gpioctrl.h"
+#include "switchbox.h"
 #include "autopilot.h"
 
+const int AdjustMs = 3000;
+const int ButtonMs = 2000;
+
 autopilot::autopilot()
 {
     simVars = &globals.simVars->simVars;
+    profile = findProfile(loadedAircraft);
     addGpio();
+    globals.gpioCtrl->start();
+    initTimers();
 
     // Initialise 7-segment displays
-    sevenSegment = new sevensegment(false, 0);
+    sevenSegment = new sevensegment(false);
+    layout = new displaylayout(sevenSegment);
 
     fflush(stdout);
 }
 
+/// <summary>
+/// Once a control hasn't been adjusted for a while digit set
+/// selection is reset and values are updated from the sim again.
+/// </summary>
+void autopilot::initTimers()
+{
+    spdAdjust.expired = [this]() {
+        spdSetSel = 0;
+    };
+
+    hdgAdjust.expired = [this]() {
+        hdgSetSel = 0;
+        if (lastHdgVal != -1) {
+            newHeading(lastHdgVal);
+        }
+    };
+
+    altAdjust.expired = [this]() {
+        altSetSel = 0;
+    };
+}
+
 void autopilot::render()
 {
     if (!globals.electrics) {
@@ -26,10 +56,8 @@ void autopilot::render()
         }
         else {
             // Turn off 7-segment displays
-            sevenSegment->blankSegData(display1, 8, false);
-            sevenSegment->blankSegData(display2, 8, false);
-            sevenSegment->blankSegData(display3, 8, false);
-            sevenSegment->writeSegData3(display1, display2, display3);
+            layout->blank();
+            layout->submit();
         }
 
         // Turn off LEDS
@@ -41,76 +69,19 @@ void autopilot::render()
 
         // Make sure settings get re-initialised
         loadedAircraft = UNDEFINED;
+        profile = findProfile(loadedAircraft);
 
         return;
     }
     *prevAbleData = '\0';
 
-    // Write to 7-segment displays
-    if (managedSpeed || !airliner) {
-        sevenSegment->blankSegData(display1, 3, true);
-        if (airliner) {
-            sevenSegment->decimalSegData(display1, 2);
-        }
-    }
-    else if (showMach) {
-        int machX100 = (mach + 0.005) * 100;
-        int whole = machX100 / 100;
-        int frac = machX100 % 100;
-        sevenSegment->getSegData(display1, 1, whole, 1);
-        sevenSegment->decimalSegData(display1, 0);
-        sevenSegment->getSegData(&display1[1], 2, frac, 2);
-    }
-    else {
-        sevenSegment->getSegData(display1, 3, speed + 0.5, 3);
-        if (spdSetSel == 1) {
-            sevenSegment->decimalSegData(display1, 1);
-        }
-    }
-
-    // Blank
-    sevenSegment->blankSegData(&display1[3], 2, false);
-
-    // Heading
-    if (managedHeading || (!airliner && autopilotHdg != HdgSet)) {
-        sevenSegment->blankSegData(&display1[5], 3, true);
-        sevenSegment->decimalSegData(&display1[5], 2);
-    }
-    else {
-        sevenSegment->getSegData(&display1[5], 3, heading, 3);
-        if (hdgSetSel == 1) {
-            sevenSegment->decimalSegData(&display1[5], 1);
-        }
-    }
-
-    // Altitude
-    sevenSegment->getSegData(display2, 8, altitude, 5);
-    if (altSetSel == 1) {
-        sevenSegment->decimalSegData(display2, 4);
-    }
-    if (managedAltitude) {
-        sevenSegment->decimalSegData(display2, 7);
-    }
-
-    // Vertical speed
-    if (loadedAircraft == AIRBUS_A310 && !managedAltitude) {
-        // For A310, managedAltitude == Selected VS
-        sevenSegment->blankSegData(display3, 3, false);
-        sevenSegment->blankSegData(&display3[3], 5, true);
-    }
-    else if (autopilotAlt == VerticalSpeedHold) {
-        sevenSegment->getSegData(display3, 8, verticalSpeed, 4);
-    }
-    else if (simVars->autopilotVerticalHold == -1) {
-        // FPA mode so verticalSpeed is the flight path angle rather than V/S
-        sevenSegment->getSegDegrees(display3, 8, fpaX10);
-    }
-    else {
-        sevenSegment->blankSegData(display3, 3, false);
-        sevenSegment->blankSegData(&display3[3], 5, true);
-    }
-
-    sevenSegment->writeSegData3(display1, display2, display3);
+    // Write to 7-segment displays. Fields are only
+    // re-formatted when their state has changed.
+    layout->setField(SpeedField, speedState());
+    layout->setField(HeadingField, headingState());
+    layout->setField(AltitudeField, altitudeState());
+    layout->setField(VerticalSpeedField, verticalSpeedState());
+    layout->submit();
 
     // Write LEDs
     globals.gpioCtrl->writeLed(autopilotControl, apEnabled);
@@ -120,13 +91,51 @@ void autopilot::render()
     globals.gpioCtrl->writeLed(approachControl, apprEnabled);
 }
 
+bool autopilot::checkLayout()
+{
+    return layout->checkSettings();
+}
+
+void autopilot::reloadLayout()
+{
+    layout->reloadSettings();
+}
+
+/// <summary>
+/// Called as soon as there is input so the new value is sent
+/// and displayed without waiting for the next frame.
+/// Everything else is left to update(). Returns false if the
+/// input has been left for update().
+/// </summary>
+bool autopilot::fastInput()
+{
+    // Let update() deal with electrics or aircraft changes first
+    aircraftInfo info = currentAircraft();
+    if (!globals.electrics || loadedAircraft != info.aircraft || loadedTitleCount != info.titleCount) {
+        return false;
+    }
+
+    handleInput();
+    return true;
+}
+
 void autopilot::update()
 {
-    // Check for aircraft change
-    bool aircraftChanged = (globals.electrics && loadedAircraft != globals.aircraft);
+    // Check for aircraft change. A new title can map to the same
+    // aircraft with a different airliner flag so check the count too.
+    aircraftInfo info = currentAircraft();
+    bool aircraftChanged = (globals.electrics &&
+        (loadedAircraft != info.aircraft || loadedTitleCount != info.titleCount));
     if (aircraftChanged) {
-        loadedAircraft = globals.aircraft;
-        airliner = (loadedAircraft != NO_AIRCRAFT && simVars->cruiseSpeed >= 300);
+        loadedAircraft = info.aircraft;
+        loadedTitleCount = info.titleCount;
+        profile = findProfile(loadedAircraft);
+        if (info.airliner != -1) {
+            airliner = (loadedAircraft != NO_AIRCRAFT && info.airliner == 1);
+        }
+        else {
+            airliner = (loadedAircraft != NO_AIRCRAFT && simVars->cruiseSpeed >= 300);
+        }
         showMach = false;
         mach = simVars->autopilotMach;
         speed = simVars->autopilotAirspeed;
@@ -145,54 +154,38 @@ void autopilot::update()
         apprEnabled = simVars->autopilotGlideslopeHold;
         lastSetHeading = -1;
         setVerticalSpeed = 0;
-        if (loadedAircraft != AIRBUS_A310 && loadedAircraft != FBW && loadedAircraft != BOEING_747) {
+        speedPoint.clear();
+        headingPoint.clear();
+        altitudePoint.clear();
+        verticalSpeedPoint.clear();
+        if (!(profile->flags & ProfileKeepManaged)) {
             managedSpeed = false;
             managedHeading = false;
             managedAltitude = false;
         }
-        prevSpdValSb = simVars->sbEncoder[2];
-        prevSpdPushSb = simVars->sbButton[2];
-        prevHdgValSb = simVars->sbEncoder[3];
-        prevHdgPushSb = simVars->sbButton[3];
-        prevAltValSb = simVars->sbEncoder[1];
-        prevAltPushSb = simVars->sbButton[1];
-        prevVsValSb = simVars->sbEncoder[0];
-        prevVsPushSb = simVars->sbButton[0];
-        prevApPushSb = simVars->sbButton[6];
-        prevLocPushSb = simVars->sbButton[5];
-        prevApprPushSb = simVars->sbButton[4];
-    }
-
-    time(&now);
-    gpioSpeedInput();
-    gpioHeadingInput();
-    gpioAltitudeInput();
-    gpioVerticalSpeedInput();
-    gpioButtonsInput();
-
-    // Only update local values from sim if they are not currently being
-    // adjusted by the rotary encoders. This stops the displayed values
-    // from jumping around due to lag of fetch/update cycle.
-    if (lastSpdAdjust == 0) {
+    }
+
+    handleInput();
+
+    // Keep showing values written by the rotary encoders until the sim
+    // confirms them. This stops the displayed values from jumping around
+    // due to lag of fetch/update cycle. Modes are only read back once the
+    // control hasn't been used for a while.
+    if (speedPoint.reconcile()) {
         mach = simVars->autopilotMach;
         speed = simVars->autopilotAirspeed;
-        if (loadedAircraft == AIRBUS_A310) {
-            managedSpeed = simVars->jbManagedSpeed;
-            showMach = simVars->jbShowMach != 0;
-        }
-        else if (loadedAircraft == FBW) {
-            managedSpeed = simVars->jbManagedSpeed;
-            showMach = simVars->jbAutothrustMode == 8;
-        }
+    }
+    if (!spdAdjust.pending() && profile->readSpeedMode) {
+        profile->readSpeedMode(simVars, &managedSpeed, &showMach);
     }
     if (orbit > 0) {
         continueOrbit();
     }
-    if (lastHdgAdjust == 0) {
+    if (!hdgAdjust.pending() && (profile->flags & ProfileManagedReadouts)) {
+        managedHeading = simVars->jbManagedHeading;
+    }
+    if (headingPoint.reconcile()) {
         heading = simVars->autopilotHeading;
-        if (loadedAircraft == AIRBUS_A310 || loadedAircraft == FBW) {
-            managedHeading = simVars->jbManagedHeading;
-        }
 
         // Hack - Fix broken heading (changes to -1 on its own!)
         if (!managedHeading && simVars->autopilotHeading == -1) {
@@ -206,13 +199,13 @@ void autopilot::update()
             lastSetHeading = simVars->autopilotHeading;
         }
     }
-    if (lastAltAdjust == 0) {
+    if (altitudePoint.reconcile()) {
         altitude = simVars->autopilotAltitude;
-        if (loadedAircraft == AIRBUS_A310 || loadedAircraft == FBW) {
-            managedAltitude = simVars->jbManagedAltitude;
-        }
     }
-    if (lastVsAdjust == 0) {
+    if (!altAdjust.pending() && (profile->flags & ProfileManagedReadouts)) {
+        managedAltitude = simVars->jbManagedAltitude;
+    }
+    if (verticalSpeedPoint.reconcile()) {
         if (simVars->autopilotVerticalHold == -1) {
             fpaX10 = simVars->autopilotVerticalSpeed * 10;
         }
@@ -220,19 +213,19 @@ void autopilot::update()
             verticalSpeed = simVars->autopilotVerticalSpeed;
         }
     }
-    if (lastApAdjust == 0) {
+    if (!apAdjust.pending()) {
         apEnabled = simVars->autopilotEngaged;
     }
-    if (lastFdAdjust == 0) {
+    if (!fdAdjust.pending()) {
         fdEnabled = simVars->flightDirectorActive;
     }
-    if (lastAthrAdjust == 0) {
+    if (!athrAdjust.pending()) {
         athrEnabled = simVars->autothrottleActive;
     }
-    if (lastLocAdjust == 0) {
+    if (!locAdjust.pending()) {
         locEnabled = simVars->autopilotApproachHold;
     }
-    if (lastApprAdjust == 0) {
+    if (!apprAdjust.pending()) {
         apprEnabled = simVars->autopilotGlideslopeHold;
     }
 
@@ -318,76 +311,28 @@ void autopilot::update()
 
 void autopilot::sendEvent(EVENT_ID id, double value = 0.0)
 {
-    if (loadedAircraft == FBW) {
-        // Convert events to FBW specific events
-        switch (id) {
-        case KEY_AP_HDG_HOLD_OFF:
-            id = A32NX_FCU_HDG_PUSH;
-            break;
-        case KEY_AP_HDG_HOLD_ON:
-            id = A32NX_FCU_HDG_PULL;
-            break;
-        case KEY_AP_ALT_HOLD_OFF:
-            id = A32NX_FCU_ALT_PUSH;
-            break;
-        case KEY_AP_ALT_HOLD_ON:
-            id = A32NX_FCU_ALT_PULL;
-            break;
-        case KEY_AP_VS_VAR_SET_ENGLISH:
-            if (value == 0) {
-                globals.simVars->write(A32NX_FCU_VS_PUSH);
-            }
-            else {
-                globals.simVars->write(A32NX_FCU_VS_PULL);
-            }
-            id = A32NX_FCU_VS_SET;
-            break;
-        case KEY_AP_APR_HOLD_OFF:
-            // Don't toggle if already in required state
-            if (simVars->jbApprMode == 0) return;
-            id = A32NX_FCU_APPR_PUSH;
-            break;
-        case KEY_AP_APR_HOLD_ON:
-            // Don't toggle if already in required state
-            if (simVars->jbApprMode == 1) return;
-            id = A32NX_FCU_APPR_PUSH;
-            break;
-        case KEY_HEADING_BUG_SET:
-            globals.simVars->write(id, value);
-            id = A32NX_FCU_HDG_SET;
-            break;
-        case KEY_AP_MACH_VAR_SET:
-        case KEY_AP_SPD_VAR_SET:
-            id = A32NX_FCU_SPD_SET;
-            break;
-        case KEY_AP_SPEED_SLOT_INDEX_SET:
-            if (value == 2) {
-                id = A32NX_FCU_SPD_PUSH;
-            }
-            else {
-                id = A32NX_FCU_SPD_PULL;
-            }
-            break;
-        case KEY_AP_HEADING_SLOT_INDEX_SET:
-            if (value == 2) {
-                id = A32NX_FCU_HDG_PUSH;
-            }
-            else {
-                id = A32NX_FCU_HDG_PULL;
-            }
-            break;
-        case KEY_AP_VS_SLOT_INDEX_SET:
-            if (value == 2) {
-                id = A32NX_FCU_ALT_PUSH;
+    // Aircraft specific events
+    const eventTranslation* translation = NULL;
+    if (profile->events) {
+        translation = &profile->events->events[id];
+    }
+
+    if (!translation || translation->writeCount == 0) {
+        globals.simVars->write(id, value);
+        return;
+    }
+
+    for (int i = 0; i < translation->writeCount; i++) {
+        const eventWrite* write = &translation->writes[i];
+        if (writeWanted(write->when, simVars, value)) {
+            if (write->withValue) {
+                globals.simVars->write(write->id, value);
             }
             else {
-                id = A32NX_FCU_ALT_PULL;
+                globals.simVars->write(write->id);
             }
-            break;
         }
     }
-
-    globals.simVars->write(id, value);
 }
 
 void autopilot::addGpio()
@@ -402,524 +347,356 @@ void autopilot::addGpio()
     autothrottleControl = globals.gpioCtrl->addButton("Autothrottle");
     localiserControl = globals.gpioCtrl->addButton("Localiser");
     approachControl = globals.gpioCtrl->addButton("Approach");
+
+    // SwitchBox knobs and buttons that can also be used
+    globals.switchBox->mapEncoder(3, headingControl);
+    globals.switchBox->mapEncoder(1, altitudeControl);
+    globals.switchBox->mapEncoder(0, verticalSpeedControl);
+    globals.switchBox->mapButton(3, headingControl);
+    globals.switchBox->mapButton(1, altitudeControl);
+    globals.switchBox->mapButton(0, verticalSpeedControl);
+    globals.switchBox->mapButton(6, autopilotControl);
+    globals.switchBox->mapButton(5, localiserControl);
+    globals.switchBox->mapButton(4, approachControl);
 }
 
-void autopilot::gpioSpeedInput()
+/// <summary>
+/// Handles all input (GPIO, SwitchBox etc.) that has arrived
+/// since the last call.
+/// </summary>
+void autopilot::handleInput()
 {
-    // Speed rotate
-    int val = globals.gpioCtrl->readRotation(speedControl);
-    int diff = (val - prevSpdVal) / 4;
-    bool switchBox = false;
-
-    if (val != INT_MIN) {
-        int adjust = 0;
-        if (diff > 0) {
-            adjust = 1;
-        }
-        else if (diff < 0) {
-            adjust = -1;
-        }
+    inputEvent event;
 
-        if (adjust != 0) {
-            // Adjust speed
-            if (showMach) {
-                double newVal = adjustMach(adjust);
-                if (loadedAircraft == AIRBUS_A310) {
-                    sendEvent(KEY_AP_SPD_VAR_SET, newVal);
-                }
-                else {
-                    sendEvent(KEY_AP_MACH_VAR_SET, newVal * 100 + 0.5);
-                }
-            }
-            else {
-                double newVal = adjustSpeed(adjust);
-                sendEvent(KEY_AP_SPD_VAR_SET, newVal);
-            }
-            if (switchBox) {
-                prevSpdValSb = val;
+    while (globals.inputQueue->take(&event)) {
+        if (event.source == SwitchBoxInput) {
+            if (switchBoxIgnored(event.control)) {
+                continue;
             }
-            else {
-                prevSpdVal = val;
+
+            if (event.action == PressAction || event.action == ReleaseAction) {
+                // So long presses are detected the same as GPIO
+                globals.gpioCtrl->setExternalPush(event.control, event.value);
             }
         }
-        time(&lastSpdAdjust);
-    }
-    else if (lastSpdAdjust != 0) {
-        // Reset digit set selection if more than 3 seconds since last adjustment
-        if (now - lastSpdAdjust > 3) {
-            spdSetSel = 0;
-            lastSpdAdjust = 0;
+
+        if (event.action == RotateAction) {
+            inputUs = event.timeUs;
+        }
+
+        if (event.control == speedControl) {
+            speedInput(event);
+        }
+        else if (event.control == headingControl) {
+            headingInput(event);
+        }
+        else if (event.control == altitudeControl) {
+            altitudeInput(event);
+        }
+        else if (event.control == verticalSpeedControl) {
+            verticalSpeedInput(event);
+        }
+        else {
+            buttonInput(event);
         }
+
+        inputUs = 0;
     }
+}
 
-    // Speed push
-    val = globals.gpioCtrl->readPush(speedControl);
-    int prevVal = prevSpdPush;
-    switchBox = false;
+/// <summary>
+/// SwitchBox mode decides which of its knobs and buttons
+/// are used by the autopilot.
+/// </summary>
+bool autopilot::switchBoxIgnored(int control)
+{
+    if (control == headingControl) {
+        // If mode is instruments but we are an airliner then first
+        // switchbox knob does autopilot heading instead of heading bug.
+        return simVars->sbMode == 2 || (simVars->sbMode == 3 && !airliner);
+    }
+
+    return simVars->sbMode > 1;
+}
 
-    if (val != INT_MIN) {
-        if (prevVal % 2 == 1) {
-            // Short press switches between 5 knot and 1 knot increments
-            // Default is 5 knots
-            if (spdSetSel == 0) {
-                spdSetSel = 1;
+void autopilot::speedInput(const inputEvent& event)
+{
+    switch (event.action) {
+    case RotateAction:
+        // Adjust speed
+        if (showMach) {
+            double newVal = adjustMach(event.value);
+            if (profile->flags & ProfileMachAsSpeed) {
+                sendEvent(KEY_AP_SPD_VAR_SET, newVal);
+                speedPoint.written(newVal, &simVars->autopilotAirspeed, 0.005);
             }
             else {
-                spdSetSel = 0;
+                sendEvent(KEY_AP_MACH_VAR_SET, newVal * 100 + 0.5);
+                speedPoint.written(newVal, &simVars->autopilotMach, 0.005);
             }
-            time(&lastSpdAdjust);
-            time(&lastSpdPush);
         }
-        if (val % 2 == 1) {
-            // Released
-            lastSpdPush = 0;
+        else {
+            double newVal = adjustSpeed(event.value, event.accel);
+            sendEvent(KEY_AP_SPD_VAR_SET, newVal);
+            speedPoint.written(newVal, &simVars->autopilotAirspeed, 0.5);
         }
-        if (switchBox) {
-            prevSpdPushSb = val;
+        globals.timerWheel->start(&spdAdjust, AdjustMs);
+        break;
+
+    case PressAction:
+        // Short press switches between 5 knot and 1 knot increments
+        // Default is 5 knots
+        if (spdSetSel == 0) {
+            spdSetSel = 1;
         }
         else {
-            prevSpdPush = val;
+            spdSetSel = 0;
         }
-    }
+        globals.timerWheel->start(&spdAdjust, AdjustMs);
+        break;
 
-    // Speed long push (over 1 sec)
-    if (lastSpdPush > 0) {
-        if (now - lastSpdPush > 1) {
-            // Long press switches between managed and selected
-            if (autopilotSpd == SpdHold) {
-                sendEvent(KEY_AP_MACH_OFF);
-                sendEvent(KEY_AP_AIRSPEED_OFF);
+    case LongPressAction:
+        // Long press switches between managed and selected
+        if (autopilotSpd == SpdHold) {
+            sendEvent(KEY_AP_MACH_OFF);
+            sendEvent(KEY_AP_AIRSPEED_OFF);
+        }
+        else {
+            if (showMach) {
+                sendEvent(KEY_AP_MACH_ON);
             }
             else {
-                if (showMach) {
-                    sendEvent(KEY_AP_MACH_ON);
-                }
-                else {
-                    sendEvent(KEY_AP_AIRSPEED_ON);
-                }
+                sendEvent(KEY_AP_AIRSPEED_ON);
             }
-            manSelSpeed();
-            spdSetSel = 0;
-            lastSpdPush = 0;
-            time(&lastSpdAdjust);
         }
+        manSelSpeed();
+        spdSetSel = 0;
+        globals.timerWheel->start(&spdAdjust, AdjustMs);
+        break;
+
+    default:
+        break;
     }
 }
 
-void autopilot::gpioHeadingInput()
+void autopilot::headingInput(const inputEvent& event)
 {
-    // Heading rotate
-    int val = globals.gpioCtrl->readRotation(headingControl);
-    int diff = (val - prevHdgVal) / 4;
-    bool switchBox = false;
-
-    // If mode is instruments but we are an airliner then first
-    // switchbox knob does autopilot heading instead of heading bug.
-    bool ignore = simVars->sbMode == 2 || (simVars->sbMode == 3 && !airliner);
-
-    if (ignore) {
-        prevHdgValSb = simVars->sbEncoder[3];
-    }
-    else if (simVars->sbEncoder[3] != prevHdgValSb) {
-        val = simVars->sbEncoder[3];
-        diff = val - prevHdgValSb;
-        switchBox = true;
+    switch (event.action) {
+    case RotateAction:
+    {
+        // Adjust heading
+        double newVal = adjustHeading(event.value, event.accel);
+        newHeading(newVal);
+        lastHdgVal = newVal;
+        globals.timerWheel->start(&hdgAdjust, AdjustMs);
+        break;
     }
 
-    if (val != INT_MIN) {
-        int adjust = 0;
-        if (diff > 0) {
-            adjust = 1;
-        }
-        else if (diff < 0) {
-            adjust = -1;
+    case PressAction:
+        // Short press switches between 5 degree and 1 degree increments
+        // Default is 1 degree
+        if (hdgSetSel == 0) {
+            hdgSetSel = 1;
         }
-
-        if (adjust != 0) {
-            // Adjust heading
-            double newVal = adjustHeading(adjust);
-            sendEvent(KEY_HEADING_BUG_SET, newVal);
-            lastHdgVal = newVal;
-
-            if (switchBox) {
-                prevHdgValSb = val;
-            }
-            else {
-                prevHdgVal = val;
-            }
-        }
-        time(&lastHdgAdjust);
-    }
-    else if (lastHdgAdjust != 0) {
-        if (now - lastHdgAdjust > 3) {
+        else {
             hdgSetSel = 0;
-            lastHdgAdjust = 0;
-            if (lastHdgVal != -1) {
-                sendEvent(KEY_HEADING_BUG_SET, lastHdgVal);
-            }
         }
-    }
-
-    // Heading push
-    val = globals.gpioCtrl->readPush(headingControl);
-    int prevVal = prevHdgPush;
-    switchBox = false;
-
-    if (ignore || prevHdgPushSb == 0) {
-        prevHdgPushSb = simVars->sbButton[3];
-    }
-    else if (simVars->sbButton[3] != prevHdgPushSb) {
-        val = simVars->sbButton[3];
-        prevVal = prevHdgPushSb;
-        switchBox = true;
-    }
+        globals.timerWheel->start(&hdgAdjust, AdjustMs);
+        break;
 
-    if (val != INT_MIN) {
-        if (prevVal % 2 == 1) {
-            // Short press switches between 5 degree and 1 degree increments
-            // Default is 1 degree
-            if (hdgSetSel == 0) {
-                hdgSetSel = 1;
+    case LongPressAction:
+        if (orbit > 0) {
+            // Turn orbit off - Allow 20 degrees to stop turn
+            if (orbit == 1) {
+                heading = simVars->hiHeading - 20.0;
+                if (heading < 0.0) {
+                    heading += 360.0;
+                }
             }
             else {
-                hdgSetSel = 0;
+                heading = simVars->hiHeading + 20.0;
+                if (heading >= 360.0) {
+                    heading -= 360.0;
+                }
             }
-            time(&lastHdgAdjust);
-            time(&lastHdgPush);
-        }
-        if (val % 2 == 1) {
-            // Released
-            lastHdgPush = 0;
-        }
-        if (switchBox) {
-            prevHdgPushSb = val;
+
+            newHeading(heading);
+            globals.timerWheel->start(&hdgAdjust, AdjustMs);
+            orbit = 0;
         }
         else {
-            prevHdgPush = val;
-        }
-    }
-
-    // Heading long push (over 1 sec)
-    if (lastHdgPush > 0) {
-        if (now - lastHdgPush > 1) {
-            if (orbit > 0) {
-                // Turn orbit off - Allow 20 degrees to stop turn
-                if (orbit == 1) {
-                    heading = simVars->hiHeading - 20.0;
-                    if (heading < 0.0) {
-                        heading += 360.0;
-                    }
+            // Long press switches between managed and selected when flight
+            // director is active or toggles heading hold when it isn't.
+            double setHeading = simVars->hiHeading;
+            if (airliner && fdEnabled) {
+                manSelHeading();
+                if (!managedHeading) {
+                    // Keep same heading when managed mode turned off
+                    newHeading(setHeading);
                 }
-                else {
-                    heading = simVars->hiHeading + 20.0;
-                    if (heading >= 360.0) {
-                        heading -= 360.0;
+            }
+            else if (autopilotHdg == HdgSet) {
+                if (apEnabled && !airliner) {
+                    // Turn orbit on if heading bug is at least 90 degrees left or right of current heading
+                    int diff = simVars->hiHeading - simVars->autopilotHeading;
+                    if (diff < 0) {
+                        diff += 360;
                     }
-                }
 
-                sendEvent(KEY_HEADING_BUG_SET, heading);
-                time(&lastHdgAdjust);
-                orbit = 0;
-            }
-            else {
-                // Long press switches between managed and selected when flight
-                // director is active or toggles heading hold when it isn't.
-                double setHeading = simVars->hiHeading;
-                if (airliner && fdEnabled) {
-                    manSelHeading();
-                    if (!managedHeading) {
-                        // Keep same heading when managed mode turned off
-                        sendEvent(KEY_HEADING_BUG_SET, setHeading);
+                    if (diff > 90 && diff < 180) {
+                        orbit = 1;
                     }
-                }
-                else if (autopilotHdg == HdgSet) {
-                    if (apEnabled && !airliner) {
-                        // Turn orbit on if heading bug is at least 90 degrees left or right of current heading
-                        int diff = simVars->hiHeading - simVars->autopilotHeading;
-                        if (diff < 0) {
-                            diff += 360;
-                        }
-
-                        if (diff > 90 && diff < 180) {
-                            orbit = 1;
-                        }
-                        else if (diff > 180 && diff < 270) {
-                            orbit = 2;
-                        }
+                    else if (diff > 180 && diff < 270) {
+                        orbit = 2;
                     }
+                }
 
-                    if (orbit > 0) {
-                        continueOrbit();
+                if (orbit > 0) {
+                    continueOrbit();
+                }
+                else {
+                    autopilotHdg = LevelFlight;
+                    if (!airliner && apEnabled && simVars->gpsDrivesNav1 > 0) {
+                        sendEvent(KEY_AP_NAV1_HOLD_ON);
                     }
                     else {
-                        autopilotHdg = LevelFlight;
-                        if (!airliner && apEnabled && simVars->gpsDrivesNav1 > 0) {
-                            sendEvent(KEY_AP_NAV1_HOLD_ON);
-                        }
-                        else {
-                            sendEvent(KEY_AP_HDG_HOLD_OFF);
-                        }
-                        manSelHeading();
-                        // Keep same heading when heading hold turned off
-                        sendEvent(KEY_HEADING_BUG_SET, setHeading);
-                        heading = setHeading;
-                        lastHdgVal = setHeading;
+                        sendEvent(KEY_AP_HDG_HOLD_OFF);
                     }
-                }
-                else {
-                    autopilotHdg = HdgSet;
-                    sendEvent(KEY_AP_HDG_HOLD_ON);
                     manSelHeading();
-                    // Keep same heading when heading hold turned on
-                    sendEvent(KEY_HEADING_BUG_SET, setHeading);
+                    // Keep same heading when heading hold turned off
+                    newHeading(setHeading);
                     heading = setHeading;
                     lastHdgVal = setHeading;
                 }
             }
-            hdgSetSel = 0;
-            lastHdgPush = 0;
-            time(&lastHdgAdjust);
+            else {
+                autopilotHdg = HdgSet;
+                sendEvent(KEY_AP_HDG_HOLD_ON);
+                manSelHeading();
+                // Keep same heading when heading hold turned on
+                newHeading(setHeading);
+                heading = setHeading;
+                lastHdgVal = setHeading;
+            }
         }
+        hdgSetSel = 0;
+        globals.timerWheel->start(&hdgAdjust, AdjustMs);
+        break;
+
+    default:
+        break;
     }
 }
 
-void autopilot::gpioAltitudeInput()
+void autopilot::altitudeInput(const inputEvent& event)
 {
-    // Altitude rotate
-    int val = globals.gpioCtrl->readRotation(altitudeControl);
-    int diff = (val - prevAltVal) / 4;
-    bool switchBox = false;
-
-    if (simVars->sbMode > 1) {
-        prevAltValSb = simVars->sbEncoder[1];
-    }
-    else if (simVars->sbEncoder[1] != prevAltValSb) {
-        val = simVars->sbEncoder[1];
-        diff = val - prevAltValSb;
-        switchBox = true;
-    }
-
-    if (val != INT_MIN) {
-        int adjust = 0;
-        if (diff > 0) {
-            adjust = 1;
-        }
-        else if (diff < 0) {
-            adjust = -1;
-        }
-
-        if (adjust != 0) {
-            // Adjust altitude
-            double newVal = adjustAltitude(adjust);
-            newAltitude(newVal);
-            if (setVerticalSpeed != 0) {
-                setAltitude = newVal;
-            }
-            if (switchBox) {
-                prevAltValSb = val;
-            }
-            else {
-                prevAltVal = val;
-            }
-        }
-        time(&lastAltAdjust);
-    }
-    else if (lastAltAdjust != 0) {
-        // Reset digit set selection if more than 3 seconds since last adjustment
-        if (now - lastAltAdjust > 3) {
-            altSetSel = 0;
-            lastAltAdjust = 0;
+    switch (event.action) {
+    case RotateAction:
+    {
+        // Adjust altitude
+        double newVal = adjustAltitude(event.value, event.accel);
+        newAltitude(newVal);
+        altitudePoint.written(newVal, &simVars->autopilotAltitude, 50);
+        if (setVerticalSpeed != 0) {
+            setAltitude = newVal;
         }
+        globals.timerWheel->start(&altAdjust, AdjustMs);
+        break;
     }
 
-    // Altitude push
-    val = globals.gpioCtrl->readPush(altitudeControl);
-    int prevVal = prevAltPush;
-    switchBox = false;
-
-    if (simVars->sbMode > 1 || prevAltPushSb == 0) {
-        prevAltPushSb = simVars->sbButton[1];
-    }
-    else if (simVars->sbButton[1] != prevAltPushSb) {
-        val = simVars->sbButton[1];
-        prevVal = prevAltPushSb;
-        switchBox = true;
-    }
-
-    if (val != INT_MIN) {
-        if (prevVal % 2 == 1) {
-            // Short press switches between 1000ft and 100ft increments
-            if (altSetSel == 1) {
-                altSetSel = 0;
-            }
-            else {
-                altSetSel++;
-            }
-            time(&lastAltAdjust);
-            time(&lastAltPush);
+    case PressAction:
+        // Short press switches between 1000ft and 100ft increments
+        if (altSetSel == 1) {
+            altSetSel = 0;
         }
-        if (val % 2 == 1) {
-            // Released
-            lastAltPush = 0;
+        else {
+            altSetSel++;
         }
-        if (switchBox) {
-            prevAltPushSb = val;
+        globals.timerWheel->start(&altAdjust, AdjustMs);
+        break;
+
+    case LongPressAction:
+        // Long press switches between managed and selected
+        if (autopilotAlt == AltHold) {
+            autopilotAlt = PitchHold;
+            sendEvent(KEY_AP_ALT_HOLD_OFF);
         }
         else {
-            prevAltPush = val;
+            autopilotAlt = AltHold;
+            sendEvent(KEY_AP_ALT_HOLD_ON);
         }
-    }
+        manSelAltitude();
+        setVerticalSpeed = 0;
+        altSetSel = 0;
+        globals.timerWheel->start(&altAdjust, AdjustMs);
+        break;
 
-    // Altitude long push (over 1 sec)
-    if (lastAltPush > 0) {
-        if (now - lastAltPush > 1) {
-            // Long press switches between managed and selected
-            if (autopilotAlt == AltHold) {
-                autopilotAlt = PitchHold;
-                sendEvent(KEY_AP_ALT_HOLD_OFF);
-            }
-            else {
-                autopilotAlt = AltHold;
-                sendEvent(KEY_AP_ALT_HOLD_ON);
-            }
-            manSelAltitude();
-            setVerticalSpeed = 0;
-            altSetSel = 0;
-            lastAltPush = 0;
-            time(&lastAltAdjust);
-        }
+    default:
+        break;
     }
 }
 
-void autopilot::gpioVerticalSpeedInput()
+void autopilot::verticalSpeedInput(const inputEvent& event)
 {
-    // Vertical speed rotate
-    int val = globals.gpioCtrl->readRotation(verticalSpeedControl);
-    int diff = (val - prevVsVal) / 4;
-    bool switchBox = false;
-
-    if (simVars->sbMode > 1) {
-        prevVsValSb = simVars->sbEncoder[0];
-    }
-    else if (simVars->sbEncoder[0] != prevVsValSb) {
-        val = simVars->sbEncoder[0];
-        diff = val - prevVsValSb;
-        switchBox = true;
-    }
-
-    if (val != INT_MIN) {
-        int adjust = 0;
-        if (diff > 0) {
-            adjust = 1;
-        }
-        else if (diff < 0) {
-            adjust = -1;
+    switch (event.action) {
+    case RotateAction:
+        if (simVars->autopilotVerticalHold == -1) {
+            // Adust FPA
+            double newVal = adjustFpa(event.value);
+            // Expects FPA x 10
+            newVerticalSpeed(newVal);
+            verticalSpeedPoint.written(newVal / 10, &simVars->autopilotVerticalSpeed, 0.05);
         }
-
-        if (adjust != 0) {
-            if (simVars->autopilotVerticalHold == -1) {
-                // Adust FPA
-                double newVal = adjustFpa(adjust);
-                // Expects FPA x 10
-                newVerticalSpeed(newVal);
-            }
-            else {
-                // Adjust vertical speed
-                double newVal = adjustVerticalSpeed(adjust);
-                newVerticalSpeed(newVal);
-                lastVsVal = newVal;
-                if (setVerticalSpeed != 0) {
-                    setVerticalSpeed = newVal;
-                }
-            }
-            if (switchBox) {
-                prevVsValSb = val;
-            }
-            else {
-                prevVsVal = val;
+        else {
+            // Adjust vertical speed
+            double newVal = adjustVerticalSpeed(event.value, event.accel);
+            newVerticalSpeed(newVal);
+            verticalSpeedPoint.written(newVal, &simVars->autopilotVerticalSpeed, 50);
+            lastVsVal = newVal;
+            if (setVerticalSpeed != 0) {
+                setVerticalSpeed = newVal;
             }
         }
-        time(&lastVsAdjust);
-    }
-    else if (lastVsAdjust != 0) {
-        if (now - lastVsAdjust > 3) {
-            lastVsAdjust = 0;
-        }
-    }
-
-    // Vertical speed push
-    val = globals.gpioCtrl->readPush(verticalSpeedControl);
-    int prevVal = prevVsPush;
-    switchBox = false;
-
-    if (simVars->sbMode > 1 || prevVsPushSb == 0) {
-        prevVsPushSb = simVars->sbButton[0];
-    }
-    else if (simVars->sbButton[0] != prevVsPushSb) {
-        val = simVars->sbButton[0];
-        prevVal = prevVsPushSb;
-        switchBox = true;
-    }
+        break;
 
-    if (val != INT_MIN) {
+    case PressAction:
         // If in selected mode, short press switches between HDG,V/S and TRK,FPA mode.
         // If in managed mode, short press switches to selected mode.
-        if (prevVal % 2 == 1) {
-            if (simVars->autopilotVerticalHold == 0 || loadedAircraft != FBW) {
-                selectedVs();
-            }
-            else {
-                // Switch between HDG,V/S and TRK,FPA mode
-                sendEvent(A32NX_FCU_TRK_FPA_TOGGLE_PUSH);
-            }
-            time(&lastVsPush);
-        }
-        if (val % 2 == 1) {
-            // Released
-            lastVsPush = 0;
-        }
-        if (switchBox) {
-            prevVsPushSb = val;
+        if (simVars->autopilotVerticalHold == 0 || !(profile->flags & ProfileVsPushTrkFpa)) {
+            selectedVs();
         }
         else {
-            prevVsPush = val;
+            // Switch between HDG,V/S and TRK,FPA mode
+            sendEvent(A32NX_FCU_TRK_FPA_TOGGLE_PUSH);
         }
-    }
+        break;
 
-    // V/S long push (over 1 sec)
-    if (lastVsPush > 0) {
-        if (now - lastVsPush > 1) {
-            // Long press switches to selected mode
-            selectedVs();
-            lastVsPush = 0;
-        }
+    case LongPressAction:
+        // Long press switches to selected mode
+        selectedVs();
+        break;
+
+    default:
+        break;
     }
 }
 
-void autopilot::gpioButtonsInput()
+void autopilot::buttonInput(const inputEvent& event)
 {
-    // Autopilot push
-    int val = globals.gpioCtrl->readPush(autopilotControl);
-    int prevVal = prevApPush;
-    int switchBox = false;
-
-    if (simVars->sbMode > 1 || prevApPushSb == 0) {
-        prevApPushSb = simVars->sbButton[6];
-    }
-    else if (simVars->sbButton[6] != prevApPushSb) {
-        val = simVars->sbButton[6];
-        prevVal = prevApPushSb;
-        switchBox = true;
+    if (event.action != PressAction && event.action != ReleaseAction) {
+        return;
     }
 
-    if (val != INT_MIN) {
-        if (prevVal % 2 == 1) {
+    bool pressed = (event.action == PressAction);
+
+    if (event.control == autopilotControl) {
+        if (pressed) {
             // Toggle autopilot
             apEnabled = !apEnabled;
             globals.gpioCtrl->writeLed(autopilotControl, apEnabled);
 
             // Capture values if autopilot has been engaged
-            if (apEnabled && loadedAircraft != AIRBUS_A310) {
+            if (apEnabled && !(profile->flags & ProfileNoCapture)) {
                 if (airliner && fdEnabled) {
                     captureInitial();
                 }
@@ -934,7 +711,7 @@ void autopilot::gpioButtonsInput()
             sendEvent(KEY_AP_MASTER, value);
 
             if (apEnabled) {
-                if (loadedAircraft == AIRBUS_A310 || loadedAircraft == CESSNA_LONGITUDE) {
+                if (profile->flags & ProfileEngageArms) {
                     // Enable autothrottle and flight director
                     athrEnabled = true;
                     globals.gpioCtrl->writeLed(autothrottleControl, athrEnabled);
@@ -952,55 +729,27 @@ void autopilot::gpioButtonsInput()
             if (!airliner && apEnabled && simVars->gpsDrivesNav1 > 0 && autopilotHdg != HdgSet) {
                 sendEvent(KEY_AP_NAV1_HOLD_ON);
             }
-
-        }
-        if (switchBox) {
-            prevApPushSb = val;
         }
-        else {
-            prevApPush = val;
-        }
-        time(&lastApAdjust);
+        globals.timerWheel->start(&apAdjust, ButtonMs);
     }
-    else if (lastApAdjust != 0) {
-        if (now - lastApAdjust > 2) {
-            lastApAdjust = 0;
-        }
-    }
-
-    // Flight Director push
-    val = globals.gpioCtrl->readPush(flightDirectorControl);
-    if (val != INT_MIN) {
-        if (prevFdPush % 2 == 1) {
+    else if (event.control == flightDirectorControl) {
+        if (pressed) {
             // Toggle flight director
             fdEnabled = !fdEnabled;
             globals.gpioCtrl->writeLed(flightDirectorControl, fdEnabled);
 
             toggleFlightDirector();
         }
-        prevFdPush = val;
-        time(&lastFdAdjust);
+        globals.timerWheel->start(&fdAdjust, ButtonMs);
     }
-    else if (lastFdAdjust != 0) {
-        if (now - lastFdAdjust > 2) {
-            lastFdAdjust = 0;
-        }
-    }
-
-    // Mach push
-    val = globals.gpioCtrl->readPush(machControl);
-    if (val != INT_MIN) {
-        if (prevMachPush % 2 == 1) {
+    else if (event.control == machControl) {
+        if (pressed) {
             // Swap between knots and mach
             machSwap();
         }
-        prevMachPush = val;
     }
-
-    // Autothrottle push
-    val = globals.gpioCtrl->readPush(autothrottleControl);
-    if (val != INT_MIN) {
-        if (prevAthrPush % 2 == 1) {
+    else if (event.control == autothrottleControl) {
+        if (pressed) {
             // Toggle autothrottle
             athrEnabled = !athrEnabled;
             globals.gpioCtrl->writeLed(autothrottleControl, athrEnabled);
@@ -1010,37 +759,16 @@ void autopilot::gpioButtonsInput()
             }
             sendEvent(KEY_AUTO_THROTTLE_ARM, value);
 
-            if (athrEnabled && loadedAircraft == AIRBUS_A310) {
+            if (athrEnabled && (profile->flags & ProfileAthrSelects)) {
                 managedSpeed = false;
                 sendEvent(KEY_AP_SPEED_SLOT_INDEX_SET, 1);
                 sendEvent(KEY_AP_SPD_VAR_SET, 210);
             }
         }
-        prevAthrPush = val;
-        time(&lastAthrAdjust);
-    }
-    else if (lastAthrAdjust != 0) {
-        if (now - lastAthrAdjust > 2) {
-            lastAthrAdjust = 0;
-        }
-    }
-
-    // Localiser push
-    val = globals.gpioCtrl->readPush(localiserControl);
-    prevVal = prevLocPush;
-    switchBox = false;
-
-    if (simVars->sbMode > 1 || prevLocPushSb == 0) {
-        prevLocPushSb = simVars->sbButton[5];
-    }
-    else if (simVars->sbButton[5] != prevLocPushSb) {
-        val = simVars->sbButton[5];
-        prevVal = prevLocPushSb;
-        switchBox = true;
+        globals.timerWheel->start(&athrAdjust, ButtonMs);
     }
-
-    if (val != INT_MIN) {
-        if (prevVal % 2 == 1) {
+    else if (event.control == localiserControl) {
+        if (pressed) {
             // Toggle localiser
             locEnabled = !locEnabled;
             globals.gpioCtrl->writeLed(localiserControl, locEnabled);
@@ -1053,36 +781,10 @@ void autopilot::gpioButtonsInput()
             }
             sendEvent(KEY_AP_LOC_HOLD, value);
         }
-        if (switchBox) {
-            prevLocPushSb = val;
-        }
-        else {
-            prevLocPush = val;
-        }
-        time(&lastLocAdjust);
-    }
-    else if (lastLocAdjust != 0) {
-        if (now - lastLocAdjust > 2) {
-            lastLocAdjust = 0;
-        }
+        globals.timerWheel->start(&locAdjust, ButtonMs);
     }
-
-    // Approach push
-    val = globals.gpioCtrl->readPush(approachControl);
-    prevVal = prevApprPush;
-    switchBox = false;
-
-    if (simVars->sbMode > 1 || prevApprPushSb == 0) {
-        prevApprPushSb = simVars->sbButton[4];
-    }
-    else if (simVars->sbButton[4] != prevApprPushSb) {
-        val = simVars->sbButton[4];
-        prevVal = prevApprPushSb;
-        switchBox = true;
-    }
-
-    if (val != INT_MIN) {
-        if (prevVal % 2 == 1) {
+    else if (event.control == approachControl) {
+        if (pressed) {
             // Toggle approach
             apprEnabled = !apprEnabled;
             globals.gpioCtrl->writeLed(approachControl, apprEnabled);
@@ -1094,18 +796,7 @@ void autopilot::gpioButtonsInput()
                 sendEvent(KEY_AP_APR_HOLD_OFF);
             }
         }
-        if (switchBox) {
-            prevApprPushSb = val;
-        }
-        else {
-            prevApprPush = val;
-        }
-        time(&lastApprAdjust);
-    }
-    else if (lastApprAdjust != 0) {
-        if (now - lastApprAdjust > 2) {
-            lastApprAdjust = 0;
-        }
+        globals.timerWheel->start(&apprAdjust, ButtonMs);
     }
 }
 
@@ -1116,7 +807,7 @@ void autopilot::machSwap()
 {
     if (showMach) {
         showMach = false;
-        if (loadedAircraft == AIRBUS_A310) {
+        if (profile->flags & ProfileConvertMach) {
             mach = simVars->autopilotAirspeed;
             sendEvent(KEY_AP_MACH_OFF);
             double celsius = 15 - 0.0019812 * simVars->altAltitude;
@@ -1127,7 +818,7 @@ void autopilot::machSwap()
     }
     else {
         showMach = true;
-        if (loadedAircraft == AIRBUS_A310) {
+        if (profile->flags & ProfileConvertMach) {
             speed = simVars->autopilotAirspeed;
             sendEvent(KEY_AP_MACH_ON);
             double celsius = 15 - 0.0019812 * simVars->altAltitude;
@@ -1137,7 +828,7 @@ void autopilot::machSwap()
         }
     }
 
-    if (loadedAircraft == FBW) {
+    if (profile->flags & ProfileMachToggle) {
         sendEvent(A32NX_FCU_SPD_MACH_TOGGLE_PUSH);
     }
 }
@@ -1309,14 +1000,14 @@ void autopilot::manSelAltitude()
 void autopilot::selectedVs()
 {
     autopilotAlt = VerticalSpeedHold;
-    if (loadedAircraft == AIRBUS_A310) {
+    if (profile->flags & ProfileVsSetOnSelect) {
         sendEvent(KEY_AP_VS_SET);
     }
     newAltitude(simVars->autopilotAltitude);
 
     sendEvent(KEY_AP_ALT_HOLD_ON);
 
-    if (loadedAircraft == BOEING_747) {
+    if (profile->flags & ProfileVsForceManSel) {
         // B747 Bug - Try to force aircraft into VS mode
         manSelAltitude();
     }
@@ -1377,14 +1068,46 @@ void autopilot::captureVerticalSpeed()
     }
 }
 
-int autopilot::adjustSpeed(int adjust)
+/// <summary>
+/// Move a value by the specified number of steps. If the encoder
+/// is being spun fast (accel > 1) the step is multiplied and the
+/// value snaps to a multiple of the larger step.
+/// </summary>
+int autopilot::accelerate(int value, int adjust, int step, int accel)
+{
+    if (accel <= 1) {
+        return value + adjust * step;
+    }
+
+    // Round down (towards minus infinity) then add one big step.
+    // Going the other way is the same with the sign reversed.
+    int bigStep = step * accel;
+    int sign = 1;
+    if (adjust < 0) {
+        sign = -1;
+        adjust = -adjust;
+        value = -value;
+    }
+
+    for (; adjust > 0; adjust--) {
+        int floorSteps = value / bigStep;
+        if (value < 0 && value % bigStep != 0) {
+            floorSteps--;
+        }
+        value = (floorSteps + 1) * bigStep;
+    }
+
+    return value * sign;
+}
+
+int autopilot::adjustSpeed(int adjust, int accel)
 {
     if (spdSetSel == 0) {
         // Adjust fives
-        speed += adjust * 5;
+        speed = accelerate(speed, adjust, 5, accel);
     }
     else {
-        speed += adjust;
+        speed = accelerate(speed, adjust, 1, accel);
     }
 
     if (speed < 0) {
@@ -1394,6 +1117,8 @@ int autopilot::adjustSpeed(int adjust)
         speed = 990;
     }
 
+    showField(SpeedField, speedState());
+
     return speed;
 }
 
@@ -1405,47 +1130,51 @@ double autopilot::adjustMach(int adjust)
         mach = 0;
     }
 
+    showField(SpeedField, speedState());
+
     return mach;
 }
 
-int autopilot::adjustHeading(int adjust)
+int autopilot::adjustHeading(int adjust, int accel)
 {
     if (hdgSetSel == 0) {
         // Adjust fives
-        heading += adjust * 5;
+        heading = accelerate(heading, adjust, 5, accel);
     }
     else {
-        heading += adjust;
+        heading = accelerate(heading, adjust, 1, accel);
     }
 
-    if (heading > 359) {
-        heading -= 360;
-    }
-    else if (heading < 0) {
+    // May have turned more than a full circle
+    heading %= 360;
+    if (heading < 0) {
         heading += 360;
     }
 
+    showField(HeadingField, headingState());
+
     return heading;
 }
 
-int autopilot::adjustAltitude(int adjust)
+int autopilot::adjustAltitude(int adjust, int accel)
 {
     int prevVal = altitude;
 
     if (altSetSel == 0) {
         // Adjust thousands
-        altitude += adjust * 1000;
+        altitude = accelerate(altitude, adjust, 1000, accel);
 
         if (altitude < 100) {
             altitude = 100;
         }
-        else if (altitude == 1100) {
-            altitude = 1000;
+        else if (prevVal == 100 && altitude % 1000 == 100) {
+            // Go from 100 to whole thousands
+            altitude -= 100;
         }
     }
     else {
         // Adjust thousands and hundreds
-        altitude += adjust * 100;
+        altitude = accelerate(altitude, adjust, 100, accel);
 
         if (altitude < 100) {
             altitude = 100;
@@ -1466,17 +1195,21 @@ int autopilot::adjustAltitude(int adjust)
         }
     }
 
+    showField(AltitudeField, altitudeState());
+
     return altitude;
 }
 
-int autopilot::adjustVerticalSpeed(int adjust)
+int autopilot::adjustVerticalSpeed(int adjust, int accel)
 {
     // Can only adjust vertical speed when in vertical speed hold mode
     if (autopilotAlt == VerticalSpeedHold) {
         // Allow vertical speed to go negative
-        verticalSpeed += adjust * 100;
+        verticalSpeed = accelerate(verticalSpeed, adjust, 100, accel);
     }
 
+    showField(VerticalSpeedField, verticalSpeedState());
+
     return verticalSpeed;
 }
 
@@ -1493,6 +1226,8 @@ double autopilot::adjustFpa(int adjust)
         fpaX10 = 99;
     }
 
+    showField(VerticalSpeedField, verticalSpeedState());
+
     return fpaX10;
 }
 
@@ -1527,11 +1262,20 @@ void autopilot::continueOrbit()
             }
         }
 
-        sendEvent(KEY_HEADING_BUG_SET, heading);
-        time(&lastHdgAdjust);
+        newHeading(heading);
+        globals.timerWheel->start(&hdgAdjust, AdjustMs);
     }
 }
 
+/// <summary>
+/// Heading set by the rotary encoder (directly or indirectly).
+/// </summary>
+void autopilot::newHeading(double newVal)
+{
+    sendEvent(KEY_HEADING_BUG_SET, newVal);
+    headingPoint.written(newVal, &simVars->autopilotHeading, 0.5);
+}
+
 void autopilot::newAltitude(double newVal)
 {
     sendEvent(KEY_AP_ALT_VAR_SET_ENGLISH, newVal);
@@ -1546,14 +1290,84 @@ void autopilot::newVerticalSpeed(double newVal)
     vsSetRetry = 30;
 }
 
+/// <summary>
+/// Shows a changed value straight away rather than waiting for the
+/// next frame to be rendered.
+/// </summary>
+void autopilot::showField(layoutField field, fieldState state)
+{
+    if (!globals.electrics) {
+        return;
+    }
+
+    layout->setField(field, state);
+    layout->submit(inputUs);
+    inputUs = 0;
+}
+
+fieldState autopilot::speedState()
+{
+    if (managedSpeed || !airliner) {
+        return { 0, FieldDashes | (airliner ? FieldManaged : 0) };
+    }
+
+    if (showMach) {
+        return { (int)((mach + 0.005) * 100), FieldMach };
+    }
+
+    return { (int)(speed + 0.5), spdSetSel == 1 ? FieldSelected : 0 };
+}
+
+fieldState autopilot::headingState()
+{
+    if (managedHeading || (!airliner && autopilotHdg != HdgSet)) {
+        return { 0, FieldDashes };
+    }
+
+    return { heading, hdgSetSel == 1 ? FieldSelected : 0 };
+}
+
+fieldState autopilot::altitudeState()
+{
+    int flags = 0;
+
+    if (altSetSel == 1) {
+        flags |= FieldSelected;
+    }
+    if (managedAltitude) {
+        flags |= FieldManaged;
+    }
+
+    return { altitude, flags };
+}
+
+fieldState autopilot::verticalSpeedState()
+{
+    if ((profile->flags & ProfileVsDashes) && !managedAltitude) {
+        // For A310, managedAltitude == Selected VS
+        return { 0, FieldDashes };
+    }
+
+    if (autopilotAlt == VerticalSpeedHold) {
+        return { verticalSpeed, 0 };
+    }
+
+    if (simVars->autopilotVerticalHold == -1) {
+        // FPA mode so verticalSpeed is the flight path angle rather than V/S
+        return { fpaX10, FieldFpa };
+    }
+
+    return { 0, FieldDashes };
+}
+
 int autopilot::getAbleData()
 {
-    time(&now);
-    if (now - lastAbleData < 3) {
+    long long nowMs = monotonicUs() / 1000;
+    if (nowMs - lastAbleDataMs < 3000) {
         return 0;
     }
 
-    lastAbleData = now;
+    lastAbleDataMs = nowMs;
 
     FILE* pipe = popen("ssh 192.168.1.55 cat /home/pi/flightradar_able/able_data", "r");
     if (!pipe) {
@@ -1579,6 +1393,10 @@ void autopilot::showAbleData()
 
     strncpy(prevAbleData, ableData, 17);
 
+    unsigned char* display1 = layout->getDisplay(0);
+    unsigned char* display2 = layout->getDisplay(1);
+    unsigned char* display3 = layout->getDisplay(2);
+
     if (ableData[0] == '-') {
         sevenSegment->blankSegData(display1, 3, false);
     }
@@ -1620,5 +1438,5 @@ void autopilot::showAbleData()
 
     }
 
-    sevenSegment->writeSegData3(display1, display2, display3);
+    layout->submit();
 }
\ No newline at end of file
@@ -3,6 +3,11 @@
 
 #include "simvars.h"
 #include "sevensegment.h"
+#include "displaylayout.h"
+#include "aircraftprofile.h"
+#include "inputqueue.h"
+#include "timerwheel.h"
+#include "setpoint.h"
 
 class autopilot
 {
@@ -27,12 +32,12 @@ private:
 
     SimVars* simVars;
     Aircraft loadedAircraft = UNDEFINED;
+    int loadedTitleCount = -1;
+    const aircraftProfile* profile;
     bool airliner = false;
     sevensegment* sevenSegment;
+    displaylayout* layout;
 
-    unsigned char display1[8];
-    unsigned char display2[8];
-    unsigned char display3[8];
     AutopilotSpd autopilotSpd;
     AutopilotHdg autopilotHdg;
     AutopilotAlt autopilotAlt = AltHold;
@@ -60,7 +65,7 @@ private:
     int vsSetRetry = 0;
     char ableData[18];
     char prevAbleData[18];
-    time_t lastAbleData = 0;
+    long long lastAbleDataMs = 0;
 
     // Hardware controls
     int speedControl = -1;
@@ -74,66 +79,49 @@ private:
     int localiserControl = -1;
     int approachControl = -1;
 
-    int prevSpdVal = 0;
-    int prevSpdPush = 0;
     int spdSetSel = 0;
-    int prevHdgVal = 0;
-    int prevHdgPush = 0;
     int hdgSetSel = 0;
-    int prevAltVal = 0;
-    int prevAltPush = 0;
     int altSetSel = 0;
-    int prevVsVal = 0;
-    int prevVsPush = 0;
-    int prevApPush = 0;
-    int prevFdPush = 0;
-    int prevMachPush = 0;
-    int prevAthrPush = 0;
-    int prevLocPush = 0;
-    int prevApprPush = 0;
-    int prevSpdValSb = 0;
-    int prevSpdPushSb = 0;
-    int prevHdgValSb = 0;
-    int prevHdgPushSb = 0;
-    int prevAltValSb = 0;
-    int prevAltPushSb = 0;
-    int prevVsValSb = 0;
-    int prevVsPushSb = 0;
-    int prevApPushSb = 0;
-    int prevLocPushSb = 0;
-    int prevApprPushSb = 0;
     double lastHdgVal = -1;
     double lastAltVal = -1;
     double lastVsVal = -1;
 
-    time_t lastSpdAdjust = 0;
-    time_t lastSpdPush = 0;
-    time_t lastHdgAdjust = 0;
-    time_t lastHdgPush = 0;
-    time_t lastAltAdjust = 0;
-    time_t lastAltPush = 0;
-    time_t lastVsAdjust = 0;
-    time_t lastVsPush = 0;
-    time_t lastApAdjust = 0;
-    time_t lastFdAdjust = 0;
-    time_t lastAthrAdjust = 0;
-    time_t lastLocAdjust = 0;
-    time_t lastApprAdjust = 0;
-    time_t now;
+    // Running while a control is being adjusted
+    timer spdAdjust;
+    timer hdgAdjust;
+    timer altAdjust;
+    timer apAdjust;
+    timer fdAdjust;
+    timer athrAdjust;
+    timer locAdjust;
+    timer apprAdjust;
+
+    // Values written to the sim that are waiting to be confirmed
+    setpoint speedPoint{ "Speed" };
+    setpoint headingPoint{ "Heading" };
+    setpoint altitudePoint{ "Altitude" };
+    setpoint verticalSpeedPoint{ "Vertical Speed" };
+    long long inputUs = 0;  // Time of detent being handled (0 = none)
 
 public:
     autopilot();
     void render();
     void update();
+    bool fastInput();
+    bool checkLayout();
+    void reloadLayout();
 
 private:
     void sendEvent(EVENT_ID id, double value);
     void addGpio();
-    void gpioSpeedInput();
-    void gpioHeadingInput();
-    void gpioAltitudeInput();
-    void gpioVerticalSpeedInput();
-    void gpioButtonsInput();
+    void handleInput();
+    bool switchBoxIgnored(int control);
+    void initTimers();
+    void speedInput(const inputEvent& event);
+    void headingInput(const inputEvent& event);
+    void altitudeInput(const inputEvent& event);
+    void verticalSpeedInput(const inputEvent& event);
+    void buttonInput(const inputEvent& event);
     void machSwap();
     void toggleFlightDirector();
     void captureInitial();
@@ -144,15 +132,22 @@ private:
     void captureCurrent();
     void captureVerticalSpeed();
     void restoreVerticalSpeed();
-    int adjustSpeed(int adjust);
+    int accelerate(int value, int adjust, int step, int accel);
+    int adjustSpeed(int adjust, int accel);
     double adjustMach(int adjust);
-    int adjustHeading(int adjust);
-    int adjustAltitude(int adjust);
-    int adjustVerticalSpeed(int adjust);
+    int adjustHeading(int adjust, int accel);
+    int adjustAltitude(int adjust, int accel);
+    int adjustVerticalSpeed(int adjust, int accel);
     double adjustFpa(int adjust);
     void continueOrbit();
+    void newHeading(double val);
     void newAltitude(double val);
     void newVerticalSpeed(double val);
+    void showField(layoutField field, fieldState state);
+    fieldState speedState();
+    fieldState headingState();
+    fieldState altitudeState();
+    fieldState verticalSpeedState();
     int getAbleData();
     void showAbleData();
 };
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "displaylayout.h"
+
+const char* LayoutGroup = "Layout";
+
+void formatSpeed(sevensegment* seg, unsigned char* buf, int size, fieldState state);
+void formatHeading(sevensegment* seg, unsigned char* buf, int size, fieldState state);
+void formatAltitude(sevensegment* seg, unsigned char* buf, int size, fieldState state);
+void formatVerticalSpeed(sevensegment* seg, unsigned char* buf, int size, fieldState state);
+
+struct layoutBinding {
+    const char* name;
+    fieldFormatter format;
+    int display;
+    int digit;
+    int size;
+    int minSize;    // Fewest digits the formatter can write into
+};
+
+// Formatter, default position and minimum size for each field
+// (indexed by layoutField). Mach needs 3 digits (0.78), altitude
+// pads to 5 and vertical speed/FPA needs 4.
+const layoutBinding Bindings[LayoutFieldCount] = {
+    { "Speed", formatSpeed, 0, 0, 3, 3 },
+    { "Heading", formatHeading, 0, 5, 3, 3 },
+    { "Altitude", formatAltitude, 1, 0, 8, 5 },
+    { "Vertical Speed", formatVerticalSpeed, 2, 0, 8, 4 }
+};
+
+///
+/// Binds autopilot fields to digit ranges on the 7-segment displays.
+///
+/// Each field keeps the state it was last formatted from and is only
+/// re-formatted when its value or mode flags change. Digits that are
+/// not bound to a field are left blank.
+///
+/// The position of each field can be changed in the "Layout" group,
+/// e.g. "Layout": { "Heading": { "Display": 3, "Digit": 5, "Size": 3 } }.
+/// A Size of 0 hides the field, otherwise it must be at least the
+/// minimum size of the field.
+///
+
+displaylayout::displaylayout(sevensegment* seg)
+{
+    sevenSegment = seg;
+    displayCount = seg->getDisplayCount();
+
+    for (int i = 0; i < MaxDisplays; i++) {
+        frame[i] = display[i];
+    }
+
+    if (!readSlots(slots)) {
+        exit(1);
+    }
+
+    blankFrame();
+}
+
+/// <summary>
+/// Reads the position of every field. Returns false (after showing
+/// the error) if any field doesn't fit on the displays.
+/// </summary>
+bool displaylayout::readSlots(layoutSlot* newSlots)
+{
+    for (int field = 0; field < LayoutFieldCount; field++) {
+        const layoutBinding* binding = &Bindings[field];
+        layoutSlot* slot = &newSlots[field];
+        const char* groupPath[2] = { LayoutGroup, binding->name };
+
+        slot->display = globals.allSettings->getInt(globals.allSettings->find(groupPath, 2, "Display"));
+        if (slot->display == INT_MIN) {
+            slot->display = binding->display;
+        }
+
+        slot->digit = globals.allSettings->getInt(globals.allSettings->find(groupPath, 2, "Digit"));
+        if (slot->digit == INT_MIN) {
+            slot->digit = binding->digit;
+        }
+
+        slot->size = globals.allSettings->getInt(globals.allSettings->find(groupPath, 2, "Size"));
+        if (slot->size == INT_MIN) {
+            slot->size = binding->size;
+        }
+
+        slot->stale = true;
+
+        if (slot->size == 0) {
+            continue;
+        }
+
+        if (slot->display < 0 || slot->display >= displayCount) {
+            printf("Cannot show %s on display %d as only %d displays are configured\n",
+                binding->name, slot->display, displayCount);
+            return false;
+        }
+
+        if (slot->digit < 0 || slot->size < 0 || slot->digit + slot->size > 8) {
+            printf("Invalid digit range specified for %s/%s\n", LayoutGroup, binding->name);
+            return false;
+        }
+
+        if (slot->size < binding->minSize) {
+            printf("Size of %s/%s must be 0 or at least %d\n", LayoutGroup, binding->name, binding->minSize);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Returns false (after showing the error) if the layout in the
+/// current settings is invalid.
+/// </summary>
+bool displaylayout::checkSettings()
+{
+    layoutSlot newSlots[LayoutFieldCount];
+
+    return readSlots(newSlots);
+}
+
+/// <summary>
+/// Called when the settings file has changed. The new layout is
+/// drawn in full on the next frame.
+/// </summary>
+void displaylayout::reloadSettings()
+{
+    layoutSlot newSlots[LayoutFieldCount];
+
+    if (!readSlots(newSlots)) {
+        printf("Keeping current layout\n");
+        return;
+    }
+
+    memcpy(slots, newSlots, sizeof(slots));
+    blankFrame();
+
+    printf("Reloaded layout\n");
+    fflush(stdout);
+}
+
+/// <summary>
+/// Re-formats the field into the frame if its state has changed.
+/// </summary>
+void displaylayout::setField(layoutField field, fieldState state)
+{
+    if (overwritten) {
+        // Frame was used for something else so redraw everything
+        blankFrame();
+        overwritten = false;
+    }
+
+    layoutSlot* slot = &slots[field];
+
+    if (slot->size == 0) {
+        return;
+    }
+
+    if (!slot->stale && state.value == slot->last.value && state.flags == slot->last.flags) {
+        return;
+    }
+
+    Bindings[field].format(sevenSegment, &display[slot->display][slot->digit], slot->size, state);
+    slot->last = state;
+    slot->stale = false;
+    dirty = true;
+}
+
+/// <summary>
+/// Gives direct access to the 8 digits of a display for
+/// anything that doesn't use the layout. All fields are
+/// redrawn on the next call to setField.
+/// </summary>
+unsigned char* displaylayout::getDisplay(int num)
+{
+    overwritten = true;
+    dirty = true;
+
+    return display[num];
+}
+
+void displaylayout::blank()
+{
+    blankFrame();
+    overwritten = true;
+    dirty = true;
+}
+
+/// <summary>
+/// Queues the frame to be written if anything has changed.
+/// inputUs is the time of the encoder detent being shown (if any).
+/// </summary>
+void displaylayout::submit(long long inputUs)
+{
+    if (dirty) {
+        sevenSegment->submitFrame(frame, displayCount, inputUs);
+        dirty = false;
+    }
+}
+
+void displaylayout::blankFrame()
+{
+    for (int i = 0; i < displayCount; i++) {
+        sevenSegment->blankSegData(display[i], 8, false);
+    }
+
+    for (int field = 0; field < LayoutFieldCount; field++) {
+        slots[field].stale = true;
+    }
+
+    dirty = true;
+}
+
+/// <summary>
+/// Speed or mach. Dashes when managed (airliner) or
+/// when there is no speed hold.
+/// </summary>
+void formatSpeed(sevensegment* seg, unsigned char* buf, int size, fieldState state)
+{
+    if (state.flags & FieldDashes) {
+        seg->blankSegData(buf, size, true);
+        if (state.flags & FieldManaged) {
+            seg->decimalSegData(buf, size - 1);
+        }
+    }
+    else if (state.flags & FieldMach) {
+        int whole = state.value / 100;
+        int frac = state.value % 100;
+        seg->getSegData(buf, size - 2, whole, 1);
+        seg->decimalSegData(buf, size - 3);
+        seg->getSegData(&buf[size - 2], 2, frac, 2);
+    }
+    else {
+        seg->getSegData(buf, size, state.value, size);
+        if (state.flags & FieldSelected) {
+            seg->decimalSegData(buf, size - 2);
+        }
+    }
+}
+
+void formatHeading(sevensegment* seg, unsigned char* buf, int size, fieldState state)
+{
+    if (state.flags & FieldDashes) {
+        seg->blankSegData(buf, size, true);
+        seg->decimalSegData(buf, size - 1);
+    }
+    else {
+        seg->getSegData(buf, size, state.value, size);
+        if (state.flags & FieldSelected) {
+            seg->decimalSegData(buf, size - 2);
+        }
+    }
+}
+
+void formatAltitude(sevensegment* seg, unsigned char* buf, int size, fieldState state)
+{
+    seg->getSegData(buf, size, state.value, 5);
+    if (state.flags & FieldSelected) {
+        seg->decimalSegData(buf, size - 4);
+    }
+    if (state.flags & FieldManaged) {
+        seg->decimalSegData(buf, size - 1);
+    }
+}
+
+/// <summary>
+/// Vertical speed or flight path angle. Dashes (right
+/// aligned) when neither is being held.
+/// </summary>
+void formatVerticalSpeed(sevensegment* seg, unsigned char* buf, int size, fieldState state)
+{
+    if (state.flags & FieldDashes) {
+        int dashes = size < 5 ? size : 5;
+        seg->blankSegData(buf, size - dashes, false);
+        seg->blankSegData(&buf[size - dashes], dashes, true);
+    }
+    else if (state.flags & FieldFpa) {
+        seg->getSegDegrees(buf, size, state.value);
+    }
+    else {
+        seg->getSegData(buf, size, state.value, 4);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef _DISPLAYLAYOUT_H_
+#define _DISPLAYLAYOUT_H_
+
+#include "globals.h"
+#include "sevensegment.h"
+
+extern globalVars globals;
+
+enum layoutField {
+    SpeedField,
+    HeadingField,
+    AltitudeField,
+    VerticalSpeedField
+};
+const int LayoutFieldCount = 4;
+
+// Mode flags that change how a field is formatted
+const int FieldDashes = 0x01;       // Show dashes instead of the value
+const int FieldManaged = 0x02;      // Managed dot
+const int FieldSelected = 0x04;     // Selected dot
+const int FieldMach = 0x08;         // Value is mach x 100
+const int FieldFpa = 0x10;          // Value is flight path angle x 10
+
+// Everything a field is formatted from. Formatting only
+// happens when this changes.
+struct fieldState {
+    int value;
+    int flags;
+};
+
+typedef void (*fieldFormatter)(sevensegment* seg, unsigned char* buf, int size, fieldState state);
+
+struct layoutSlot {
+    int display;    // Display number (left to right across all chains)
+    int digit;      // First digit (0 = leftmost)
+    int size;       // Number of digits (0 = not shown)
+    bool stale;     // Must be formatted on next update
+    fieldState last;
+};
+
+class displaylayout
+{
+private:
+    sevensegment* sevenSegment;
+    int displayCount;
+    unsigned char display[MaxDisplays][8];
+    unsigned char* frame[MaxDisplays];
+    layoutSlot slots[LayoutFieldCount];
+    bool overwritten = true;
+    bool dirty = false;
+
+public:
+    displaylayout(sevensegment* seg);
+    void setField(layoutField field, fieldState state);
+    unsigned char* getDisplay(int num);
+    void blank();
+    void submit(long long inputUs = 0);
+    bool checkSettings();
+    void reloadSettings();
+
+private:
+    bool readSlots(layoutSlot* newSlots);
+    void blankFrame();
+};
+
+#endif // _DISPLAYLAYOUT_H_
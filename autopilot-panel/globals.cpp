@@ -1,3 +1,5 @@
+#include <time.h>
+#include <stddef.h>
 #include "globals.h"
 #include "simvars.h"
 
@@ -6,72 +8,58 @@ extern globalVars globals;
 const int deltaDoubleSize = sizeof(DeltaDouble);
 const int deltaStringSize = sizeof(DeltaString);
 
-void identifyAircraft(char* aircraft)
+/// <summary>
+/// Milliseconds from a clock that never jumps (unaffected by NTP
+/// or manual changes to the system time).
+/// </summary>
+long long monotonicMs()
 {
-    // Identify aircraft
-    if (strcmp(aircraft, globals.lastAircraft) != 0) {
-        bool foundAircraft = false;
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-        char* pos = strchr(aircraft, '3');
-        if (pos && *(pos - 1) == 'A') {
-            if (*(pos + 1) == '1') {
-                globals.aircraft = AIRBUS_A310;
-                foundAircraft = true;
-            }
-            else if (*(pos + 1) == '2' || *(pos + 1) == '8') {
-                globals.aircraft = FBW;
-                foundAircraft = true;
-            }
-        }
+long long monotonicUs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
 
-        if (!foundAircraft) {
-            if (strncmp(aircraft, globals.Cessna_152_Text, globals.Cessna_152_Len) == 0) {
-                globals.aircraft = CESSNA_152;
-            }
-            else if (strncmp(aircraft, globals.Cessna_172_Text, globals.Cessna_172_Len) == 0) {
-                globals.aircraft = CESSNA_172;
-            }
-            else if (strncmp(aircraft, globals.Cessna_CJ4_Text, globals.Cessna_CJ4_Len) == 0) {
-                globals.aircraft = CESSNA_CJ4;
-            }
-            else if (strncmp(aircraft, globals.Cessna_Longitude_Text, globals.Cessna_Longitude_Len) == 0) {
-                globals.aircraft = CESSNA_LONGITUDE;
-            }
-            else if (strncmp(aircraft, globals.Savage_Cub_Text, globals.Savage_Cub_Len) == 0) {
-                globals.aircraft = SAVAGE_CUB;
-            }
-            else if (strncmp(aircraft, globals.Shock_Ultra_Text, globals.Shock_Ultra_Len) == 0) {
-                globals.aircraft = SHOCK_ULTRA;
-            }
-            else if (strncmp(aircraft, globals.Boeing_747_Text, globals.Boeing_747_Len) == 0) {
-                globals.aircraft = BOEING_747;
-            }
-            else if (strncmp(aircraft, globals.Salty_Boeing_747_Text, globals.Salty_Boeing_747_Len) == 0) {
-                globals.aircraft = BOEING_747;
-            }
-            else if (strncmp(aircraft, globals.Supermarine_Spitfire_Text, globals.Supermarine_Spitfire_Len) == 0) {
-                globals.aircraft = SUPERMARINE_SPITFIRE;
-            }
-            else {
-                // Need to flip between other aircraft so that instruments
-                // can detect the aircraft has changed.
-                if (globals.aircraft == OTHER_AIRCRAFT) {
-                    globals.aircraft = OTHER_AIRCRAFT2;
-                }
-                else {
-                    globals.aircraft = OTHER_AIRCRAFT;
-                }
-            }
-        }
-        strcpy(globals.lastAircraft, aircraft);
-    }
+/// <summary>
+/// Packs the aircraft details into a single atomic so the render
+/// thread always sees them together. Bits 0-7 aircraft, 8-11
+/// electrics rule, 12-15 airliner + 1, 16-31 title count. Zero is
+/// UNDEFINED with no airliner preference.
+/// </summary>
+void publishAircraft(Aircraft aircraft, int airliner, ElectricsRule electricsRule)
+{
+    // Only the data link writes so the count can be read relaxed
+    unsigned int count = (globals.aircraftPacked.load(std::memory_order_relaxed) >> 16) + 1;
+    unsigned int packed = (count << 16) | ((airliner + 1) & 0xf) << 12
+        | (electricsRule & 0xf) << 8 | (aircraft & 0xff);
+    globals.aircraftPacked.store(packed, std::memory_order_release);
+}
+
+aircraftInfo currentAircraft()
+{
+    unsigned int packed = globals.aircraftPacked.load(std::memory_order_acquire);
+    aircraftInfo info;
+    info.aircraft = (Aircraft)(packed & 0xff);
+    info.electricsRule = (ElectricsRule)((packed >> 8) & 0xf);
+    info.airliner = (int)((packed >> 12) & 0xf) - 1;
+    info.titleCount = (int)(packed >> 16);
+    return info;
 }
 
 /// <summary>
 /// Server can send us a delta rather than full data so we need to unpack it.
+/// Returns true if the aircraft title has changed.
 /// </summary>
-void receiveDelta(char *deltaData, int deltaSize, char* simVarsPtr)
+bool receiveDelta(char *deltaData, int deltaSize, char* simVarsPtr)
 {
+    const int titleOffset = offsetof(SimVars, aircraft);
+    bool titleChanged = false;
     char* dataPtr = deltaData;
 
     int tempDeltaSize = deltaSize;
@@ -80,7 +68,11 @@ void receiveDelta(char *deltaData, int deltaSize, char* simVarsPtr)
         if (deltaDouble->offset & 0x10000) {
             // Must be a string
             DeltaString* deltaString = (DeltaString*)dataPtr;
-            char* stringPtr = simVarsPtr + (deltaString->offset & 0xffff);
+            int offset = deltaString->offset & 0xffff;
+            char* stringPtr = simVarsPtr + offset;
+            if (offset == titleOffset && strncmp(stringPtr, deltaString->data, 31) != 0) {
+                titleChanged = true;
+            }
             strncpy(stringPtr, deltaString->data, 32);
             stringPtr[31] = '\0';
 
@@ -97,4 +89,6 @@ void receiveDelta(char *deltaData, int deltaSize, char* simVarsPtr)
             deltaSize -= deltaDoubleSize;
         }
     }
+
+    return titleChanged;
 }
@@ -2,11 +2,18 @@
 #define _GLOBALS_H_
 
 #include <cstring>
+#include <atomic>
 #define _stricmp strcasecmp
 
 class settings;
 class simvars;
 class gpioctrl;
+class realtime;
+class hardware;
+class hotreload;
+class inputqueue;
+class switchbox;
+class timerwheel;
 
 enum Aircraft {
     UNDEFINED,
@@ -25,26 +32,27 @@ enum Aircraft {
     OTHER_AIRCRAFT2,
 };
 
+// How to tell if the autopilot has power
+enum ElectricsRule {
+    VOLTS_ELECTRICS,        // Any DC volts
+    BATTERY_ELECTRICS,      // Both batteries or external/APU/engine power
+    PITCH_TRIM_ELECTRICS    // Battery in use and pitch trim on
+};
+
+/// <summary>
+/// Identified aircraft and how to treat it. Published as one packed
+/// value so a reader never sees the fields from different titles.
+/// </summary>
+struct aircraftInfo
+{
+    Aircraft aircraft;
+    int airliner;           // 1 = airliner, 0 = not, -1 = decide from cruise speed
+    ElectricsRule electricsRule;
+    int titleCount;         // Changes whenever a title is identified
+};
+
 struct globalVars
 {
-    const char* Cessna_152_Text = "Cessna 152";
-    const int Cessna_152_Len = 10;
-    const char* Cessna_172_Text = "Cessna Skyhawk";
-    const int Cessna_172_Len = 14;
-    const char* Cessna_CJ4_Text = "Cessna CJ4";
-    const int Cessna_CJ4_Len = 10;
-    const char* Cessna_Longitude_Text = "Cessna Longitude";
-    const int Cessna_Longitude_Len = 16;
-    const char* Savage_Cub_Text = "Asobo Savage Cub";
-    const int Savage_Cub_Len = 16;
-    const char* Shock_Ultra_Text = "Savage Shock Ultra";
-    const int Shock_Ultra_Len = 18;
-    const char* Boeing_747_Text = "Boeing 747-8";
-    const int Boeing_747_Len = 12;
-    const char* Salty_Boeing_747_Text = "Salty Boeing 747";
-    const int Salty_Boeing_747_Len = 16;
-    const char* Supermarine_Spitfire_Text = "FlyingIron Spitfire";
-    const int Supermarine_Spitfire_Len = 19;
     const int FastAircraftSpeed = 195;
 
     const char* BitmapDir = "bitmaps/";
@@ -54,8 +62,15 @@ struct globalVars
     settings* allSettings = NULL;
     simvars* simVars = NULL;
     gpioctrl* gpioCtrl = NULL;
-    Aircraft aircraft;
-    char lastAircraft[32];
+    realtime* realTime = NULL;
+    hardware* hw = NULL;
+    hotreload* hotReload = NULL;
+    inputqueue* inputQueue = NULL;
+    switchbox* switchBox = NULL;
+    timerwheel* timerWheel = NULL;
+    // Written by the data link only. Use publishAircraft and
+    // currentAircraft rather than reading this directly.
+    std::atomic<unsigned int> aircraftPacked{ 0 };
 
     long dataRateFps = 16;
     bool quit = false;
@@ -65,4 +80,9 @@ struct globalVars
     bool avionics = false;
 };
 
+long long monotonicMs();
+long long monotonicUs();
+void publishAircraft(Aircraft aircraft, int airliner, ElectricsRule electricsRule);
+aircraftInfo currentAircraft();
+
 #endif // _GLOBALS_H_
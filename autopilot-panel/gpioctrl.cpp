@@ -2,8 +2,12 @@
 #include <stdlib.h>
 #include <cstring>
 #include <set>
-#include <wiringPi.h>
+#include <time.h>
+#include <unistd.h>
 #include "settings.h"
+#include "realtime.h"
+#include "hardware.h"
+#include "inputqueue.h"
 #include "gpioctrl.h"
 
 const char* GpioGroup = "GPIO";
@@ -11,25 +15,32 @@ const char* RotaryEncoderGroup = "RotaryEncoder";   // Rot1, Rot2, Push
 const char* ButtonGroup = "Button";                 // Push, Led
 const char* SwitchGroup = "Switch";                 // Toggle, Led
 const char* LampGroup = "Lamp";                     // Led
+extern const char* DisplayGroup;
 
 // SPI GPIO pins
 const int SPI_MOSI = 10;
 const int SPI_SCLK = 11;
 const int SPI_CE0 = 8;
+const int SPI_CE1 = 7;
 
 void watcher(gpioctrl*);
 
-gpioctrl::gpioctrl(bool initWiringPi)
+gpioctrl::gpioctrl(bool initHardware)
 {
-    // Caller may want to initialise wiringPi themselves
-    if (initWiringPi) {
-        // Use BCM GPIO pin numbers
-        wiringPiSetupGpio();
+    // Caller may want to initialise hardware themselves
+    if (initHardware) {
+        globals.hw->setup();
     }
 
     // Reserve pins for SPI channel 0 with no MISO
     printf("Added SPI CE0 with no MISO: GPIO%d, GPIO%d, GPIO%d\n", SPI_MOSI, SPI_SCLK, SPI_CE0);
 
+    // Also reserve CE1 if a second display chain is connected
+    int ce1Displays = globals.allSettings->getInt(DisplayGroup, "CE1 Displays");
+    if (ce1Displays != INT_MIN && ce1Displays > 0) {
+        useCe1 = true;
+        printf("Added SPI CE1: GPIO%d\n", SPI_CE1);
+    }
 }
 
 gpioctrl::~gpioctrl()
@@ -42,13 +53,12 @@ gpioctrl::~gpioctrl()
 
 int gpioctrl::getSetting(const char* controlName, const char *controlType, const char *attribute)
 {
-    char settingGroup[256];
+    const char* groupPath[3] = { GpioGroup, controlName, controlType };
 
-    sprintf(settingGroup, "%s/%s/%s", GpioGroup, controlName, controlType);
-    return globals.allSettings->getInt(settingGroup, attribute);
+    return globals.allSettings->getInt(globals.allSettings->find(groupPath, 3, attribute));
 }
 
-int gpioctrl::addControl()
+int gpioctrl::addControl(const char* name)
 {
     if (controlCount >= MaxControls) {
         printf("Maximum number of GPIO controls exceeded\n");
@@ -58,6 +68,8 @@ int gpioctrl::addControl()
     int num = controlCount;
     controlCount++;
 
+    controlName[num] = name;
+
     gpio[num][Rot1] = INT_MIN;
     gpio[num][Rot2] = INT_MIN;
     gpio[num][Push] = INT_MIN;
@@ -67,11 +79,25 @@ int gpioctrl::addControl()
     rotateValue[num] = 0;
     pushValue[num] = 0;
     toggleValue[num] = 1;   // Default to high (off)
-    lastRotateValue[num] = -1;
-    lastPushValue[num] = -1;
+    lastRotateValue[num] = 0;
     lastRotateState[num] = -1;
     lastPushState[num] = -1;
     clockwise[num] = true;
+    externalPush[num] = 0;
+    lastExternalPush[num] = 0;
+    timing[num] = DefaultTimings;
+    pushDownMs[num] = 0;
+    nextHoldMs[num] = 0;
+    lastClickMs[num] = 0;
+    longPressFired[num] = false;
+    lastDetentMs[num] = 0;
+    rotateAccel[num] = 1;
+    bounceCount[num] = 0;
+    for (int i = 0; i < 2; i++) {
+        rawState[num][i] = -1;
+        stableState[num][i] = -1;
+        rawChangeMs[num][i] = 0;
+    }
 
     return num;
 }
@@ -84,6 +110,9 @@ void gpioctrl::validateControl(const char* controlName, int control)
     usedPins.insert(SPI_MOSI);
     usedPins.insert(SPI_SCLK);
     usedPins.insert(SPI_CE0);
+    if (useCe1) {
+        usedPins.insert(SPI_CE1);
+    }
 
     // Find all pins already in use
     for (int num = 0; num < controlCount; num++) {
@@ -133,7 +162,7 @@ void gpioctrl::validateControl(const char* controlName, int control)
 
 int gpioctrl::addRotaryEncoder(const char *controlName)
 {
-    int newControl = addControl();
+    int newControl = addControl(controlName);
 
     gpio[newControl][Rot1] = getSetting(controlName, RotaryEncoderGroup, "Rot1");
     gpio[newControl][Rot2] = getSetting(controlName, RotaryEncoderGroup, "Rot2");
@@ -171,13 +200,17 @@ int gpioctrl::addRotaryEncoder(const char *controlName)
         printf("%s\n", msg);
     }
 
+    controlType[newControl] = RotaryEncoderGroup;
+    if (!readTimings(newControl, &timing[newControl])) {
+        exit(1);
+    }
     validateControl(controlName, newControl);
     return newControl;
 }
 
 int gpioctrl::addButton(const char* controlName)
 {
-    int newControl = addControl();
+    int newControl = addControl(controlName);
 
     gpio[newControl][Push] = getSetting(controlName, ButtonGroup, "Push");
     gpio[newControl][Led] = getSetting(controlName, ButtonGroup, "Led");
@@ -207,13 +240,17 @@ int gpioctrl::addButton(const char* controlName)
         printf("%s\n", msg);
     }
 
+    controlType[newControl] = ButtonGroup;
+    if (!readTimings(newControl, &timing[newControl])) {
+        exit(1);
+    }
     validateControl(controlName, newControl);
     return newControl;
 }
 
 int gpioctrl::addSwitch(const char* controlName)
 {
-    int newControl = addControl();
+    int newControl = addControl(controlName);
 
     gpio[newControl][Toggle] = getSetting(controlName, SwitchGroup, "Toggle");
     gpio[newControl][Led] = getSetting(controlName, SwitchGroup, "Led");
@@ -243,14 +280,19 @@ int gpioctrl::addSwitch(const char* controlName)
         printf("%s\n", msg);
     }
 
+    controlType[newControl] = SwitchGroup;
+    if (!readTimings(newControl, &timing[newControl])) {
+        exit(1);
+    }
     validateControl(controlName, newControl);
     return newControl;
 }
 
 int gpioctrl::addLamp(const char* controlName)
 {
-    int newControl = addControl();
+    int newControl = addControl(controlName);
 
+    controlType[newControl] = LampGroup;
     gpio[newControl][Led] = getSetting(controlName, LampGroup, "Led");
 
     if (gpio[newControl][Led] != INT_MIN) {
@@ -262,69 +304,356 @@ int gpioctrl::addLamp(const char* controlName)
     return newControl;
 }
 
-void gpioctrl::initPin(int pin, bool isInput)
+/// <summary>
+/// Reads the push, acceleration and debounce thresholds that apply to
+/// the type of control, starting from the defaults. Returns false
+/// (after showing the error) if any are invalid.
+/// </summary>
+bool gpioctrl::readTimings(int control, controlTimings* newTiming)
 {
-    char command[256];
+    *newTiming = DefaultTimings;
 
-    // NOTE: pullUpDnControl does not work on RasPi4 so have
-    // to use raspi-gpio command line to pull up resistors.
-    if (isInput) {
-        sprintf(command, "raspi-gpio set %d pu", pin);
+    if (controlType[control] == RotaryEncoderGroup || controlType[control] == ButtonGroup) {
+        if (!readPushTimings(control, newTiming)) {
+            return false;
+        }
     }
-    else {
-        sprintf(command, "raspi-gpio set %d op", pin);
+
+    if (controlType[control] == RotaryEncoderGroup) {
+        if (!readAcceleration(control, newTiming)) {
+            return false;
+        }
     }
 
-    if (system(command) != 0) {
-        printf("Failed to run raspi-gpio command\n");
-        exit(1);
+    if (controlType[control] != LampGroup) {
+        if (!readDebounce(control, newTiming)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Optional per-control push thresholds in milliseconds.
+/// LongPress = time held before a long press fires.
+/// HoldRepeat = interval between repeats while still held after
+/// a long press (0 = no repeat).
+/// DoubleClick = max time between release and next press to count
+/// as a double click (0 = no double click).
+/// </summary>
+bool gpioctrl::readPushTimings(int control, controlTimings* newTiming)
+{
+    int val = getSetting(controlName[control], controlType[control], "LongPress");
+    if (val != INT_MIN) {
+        newTiming->longPressMs = val;
+    }
+
+    val = getSetting(controlName[control], controlType[control], "HoldRepeat");
+    if (val != INT_MIN) {
+        newTiming->holdRepeatMs = val;
+    }
+
+    val = getSetting(controlName[control], controlType[control], "DoubleClick");
+    if (val != INT_MIN) {
+        newTiming->doubleClickMs = val;
+    }
+
+    if (newTiming->longPressMs <= 0 || newTiming->holdRepeatMs < 0 || newTiming->doubleClickMs < 0) {
+        printf("Invalid push timings specified for %s\n", controlName[control]);
+        return false;
     }
+
+    return true;
 }
 
-int gpioctrl::readRotation(int control)
+/// <summary>
+/// Optional rotary encoder acceleration.
+/// AccelMax = largest step multiplier (1 or not specified = no acceleration).
+/// AccelMs = time between detents (ms) below which acceleration starts.
+/// The multiplier grows as the detents get closer together.
+/// </summary>
+bool gpioctrl::readAcceleration(int control, controlTimings* newTiming)
 {
-    // Disabled if no GPIO specified in settings file
-    if (gpio[control][Rot1] == INT_MIN) {
-        return INT_MIN;
+    int val = getSetting(controlName[control], RotaryEncoderGroup, "AccelMax");
+    if (val != INT_MIN) {
+        newTiming->accelMax = val;
+    }
+
+    val = getSetting(controlName[control], RotaryEncoderGroup, "AccelMs");
+    if (val != INT_MIN) {
+        newTiming->accelMs = val;
     }
 
-    int newVal = INT_MIN;
+    if (newTiming->accelMax < 1 || newTiming->accelMs < 0 || (newTiming->accelMax > 1 && newTiming->accelMs == 0)) {
+        printf("Invalid acceleration specified for %s\n", controlName[control]);
+        return false;
+    }
 
-    if (watcherThread) {
-        if (control >= 0 && rotateValue[control] != lastRotateValue[control]) {
-            newVal = rotateValue[control];
-            lastRotateValue[control] = newVal;
+    return true;
+}
+
+/// <summary>
+/// Optional per-control debounce time in milliseconds (0 = off).
+/// A push or toggle must hold its new level for this long before
+/// the change is accepted.
+/// </summary>
+bool gpioctrl::readDebounce(int control, controlTimings* newTiming)
+{
+    int val = getSetting(controlName[control], controlType[control], "Debounce");
+    if (val != INT_MIN) {
+        newTiming->debounceMs = val;
+    }
+
+    if (newTiming->debounceMs < 0) {
+        printf("Invalid debounce specified for %s\n", controlName[control]);
+        return false;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Returns false (after showing the error) if any control thresholds
+/// in the current settings are invalid.
+/// </summary>
+bool gpioctrl::checkSettings()
+{
+    controlTimings newTiming;
+
+    for (int control = 0; control < controlCount; control++) {
+        if (!readTimings(control, &newTiming)) {
+            return false;
         }
     }
-    else {
-        // Start monitoring controls on first read
+
+    return true;
+}
+
+/// <summary>
+/// Called when the settings file has changed. Thresholds are re-read
+/// and handed to the watcher which swaps them all in at once between
+/// samples. Pin changes need a restart.
+/// </summary>
+void gpioctrl::reloadSettings()
+{
+    controlTimings newTiming[MaxControls];
+
+    for (int control = 0; control < controlCount; control++) {
+        if (!readTimings(control, &newTiming[control])) {
+            printf("Keeping current control settings\n");
+            return;
+        }
+    }
+
+    const int pinTypes[5] = { Rot1, Rot2, Push, Toggle, Led };
+    const char* pinNames[5] = { "Rot1", "Rot2", "Push", "Toggle", "Led" };
+    for (int control = 0; control < controlCount; control++) {
+        for (int i = 0; i < 5; i++) {
+            if (getSetting(controlName[control], controlType[control], pinNames[i]) != gpio[control][pinTypes[i]]) {
+                printf("Restart needed to change %s/%s pin\n", controlName[control], pinNames[i]);
+            }
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(timingMutex);
+        memcpy(pendingTiming, newTiming, sizeof(controlTimings) * controlCount);
+        timingPending = true;
+    }
+
+    printf("Reloaded control settings\n");
+    fflush(stdout);
+}
+
+/// <summary>
+/// Called by the watcher to swap in reloaded thresholds.
+/// </summary>
+void gpioctrl::applyTimings()
+{
+    if (!timingPending) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(timingMutex);
+    memcpy(timing, pendingTiming, sizeof(controlTimings) * controlCount);
+    timingPending = false;
+}
+
+void gpioctrl::initPin(int pin, bool isInput)
+{
+    globals.hw->initPin(pin, isInput);
+}
+
+/// <summary>
+/// Starts monitoring controls. Called once all controls have been
+/// added. Input is posted to the input queue as it happens.
+/// </summary>
+void gpioctrl::start()
+{
+    if (!watcherThread) {
         watcherThread = new std::thread(watcher, this);
     }
+}
 
-    return newVal;
+/// <summary>
+/// Allows a push from another source (e.g. SwitchBox) to be classified
+/// the same way as a GPIO push. Uses the same odd (released) / even
+/// (pressed) values as GPIO pushes.
+/// </summary>
+void gpioctrl::setExternalPush(int control, int val)
+{
+    if (control >= 0) {
+        externalPush[control] = val;
+    }
 }
 
-int gpioctrl::readPush(int control)
+/// <summary>
+/// Called by the watcher whenever a push changes state.
+/// If double click is enabled for the control a click is reported on
+/// release (unless a long press has already fired) and a second click
+/// within the window is reported as a double click instead. Without
+/// it the press and release events are all that's needed.
+/// </summary>
+void gpioctrl::classifyPush(int control, bool pressed, long long nowMs)
 {
-    // Disabled if no GPIO specified in settings file
-    if (gpio[control][Push] == INT_MIN) {
-        return INT_MIN;
+    if (pressed) {
+        pushDownMs[control] = nowMs;
+        nextHoldMs[control] = nowMs + timing[control].longPressMs;
+        longPressFired[control] = false;
+        return;
     }
 
-    int newVal = INT_MIN;
+    if (pushDownMs[control] == 0) {
+        // Released without seeing the press (e.g. at startup)
+        return;
+    }
 
-    if (watcherThread) {
-        if (control >= 0 && pushValue[control] != lastPushValue[control]) {
-            newVal = pushValue[control];
-            lastPushValue[control] = newVal;
+    if (!longPressFired[control] && timing[control].doubleClickMs > 0) {
+        if (lastClickMs[control] != 0
+            && pushDownMs[control] - lastClickMs[control] <= timing[control].doubleClickMs)
+        {
+            globals.inputQueue->post({ control, DoubleClickAction, GpioInput, 0, 1, nowMs * 1000 });
+            lastClickMs[control] = 0;
         }
+        else {
+            globals.inputQueue->post({ control, ClickAction, GpioInput, 0, 1, nowMs * 1000 });
+            lastClickMs[control] = nowMs;
+        }
+    }
+
+    pushDownMs[control] = 0;
+}
+
+/// <summary>
+/// Called by the watcher every cycle while a push is held down.
+/// </summary>
+void gpioctrl::checkHold(int control, long long nowMs)
+{
+    if (pushDownMs[control] == 0 || nowMs < nextHoldMs[control]) {
+        return;
+    }
+
+    if (!longPressFired[control]) {
+        globals.inputQueue->post({ control, LongPressAction, GpioInput, 0, 1, nowMs * 1000 });
+        longPressFired[control] = true;
+        lastClickMs[control] = 0;
+    }
+    else if (timing[control].holdRepeatMs > 0) {
+        // Only when enabled (may have been turned off by a reload)
+        globals.inputQueue->post({ control, HoldRepeatAction, GpioInput, 0, 1, nowMs * 1000 });
+    }
+
+    if (timing[control].holdRepeatMs > 0) {
+        nextHoldMs[control] = nowMs + timing[control].holdRepeatMs;
     }
     else {
-        // Start monitoring controls on first read
-        watcherThread = new std::thread(watcher, this);
+        nextHoldMs[control] = LLONG_MAX;
     }
+}
+
+/// <summary>
+/// Called by the watcher each time an encoder reaches a detent
+/// (every 4 transitions). Works out the acceleration from the
+/// time since the previous detent and posts the turn so the
+/// render loop can show the new value straight away.
+/// </summary>
+void gpioctrl::detent(int control, long long nowUs)
+{
+    long long nowMs = nowUs / 1000;
 
-    return newVal;
+    if (timing[control].accelMax > 1) {
+        long long interval = nowMs - lastDetentMs[control];
+        if (interval < 1) {
+            interval = 1;
+        }
+
+        int ratio = timing[control].accelMs / interval;
+        if (ratio > timing[control].accelMax) {
+            ratio = timing[control].accelMax;
+        }
+
+        int accel = 1;
+        for (int i = 1; i < AccelStepCount && AccelSteps[i] <= ratio; i++) {
+            accel = AccelSteps[i];
+        }
+
+        rotateAccel[control] = accel;
+    }
+
+    lastDetentMs[control] = nowMs;
+
+    // Turning back to the previous detent cancels out
+    int detents = (rotateValue[control] - lastRotateValue[control]) / 4;
+    lastRotateValue[control] = rotateValue[control];
+    if (detents != 0) {
+        globals.inputQueue->post({ control, RotateAction, GpioInput, detents, rotateAccel[control], nowUs });
+    }
+}
+
+/// <summary>
+/// Called by the watcher with the raw level of a push or toggle pin.
+/// Returns the debounced level. A raw change that reverts before the
+/// debounce time has elapsed is counted as a rejected bounce.
+/// </summary>
+int gpioctrl::debounce(int control, debounceSlot slot, int raw, long long nowMs)
+{
+    if (stableState[control][slot] == -1) {
+        // Accept initial state
+        stableState[control][slot] = raw;
+        rawState[control][slot] = raw;
+        return raw;
+    }
+
+    if (raw != rawState[control][slot]) {
+        if (raw == stableState[control][slot]) {
+            // Went back before change was accepted
+            bounceCount[control]++;
+        }
+        rawState[control][slot] = raw;
+        rawChangeMs[control][slot] = nowMs;
+    }
+
+    if (raw != stableState[control][slot] && nowMs - rawChangeMs[control][slot] >= timing[control].debounceMs) {
+        stableState[control][slot] = raw;
+    }
+
+    return stableState[control][slot];
+}
+
+void gpioctrl::printBounces()
+{
+    bool first = true;
+    for (int control = 0; control < controlCount; control++) {
+        if (bounceCount[control] > 0) {
+            if (first) {
+                printf("Rejected switch bounces:\n");
+                first = false;
+            }
+            printf("  %s: %d (debounce %d ms)\n", controlName[control], bounceCount[control], timing[control].debounceMs);
+        }
+    }
+    fflush(stdout);
 }
 
 void gpioctrl::writeLed(int control, bool on)
@@ -335,10 +664,10 @@ void gpioctrl::writeLed(int control, bool on)
     }
 
     if (on) {
-        digitalWrite(gpio[control][Led], 1);
+        globals.hw->writePin(gpio[control][Led], 1);
     }
     else {
-        digitalWrite(gpio[control][Led], 0);
+        globals.hw->writePin(gpio[control][Led], 0);
     }
 }
 
@@ -351,12 +680,31 @@ void gpioctrl::writeLed(int control, bool on)
 void watcher(gpioctrl *t)
 {
     int state;
+    long long nowMs;
+    long long nowUs;
+    long long prevUs = 0;
+    timespec deadline;
+
+    globals.realTime->configureThread("Watcher");
+    bool fixedPeriod = globals.realTime->isEnabled();
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
 
     while (!globals.quit) {
+        nowUs = monotonicUs();
+        nowMs = nowUs / 1000;
+        if (prevUs != 0 && globals.realTime->addSample(nowUs - prevUs, nowMs)) {
+            globals.realTime->printJitter();
+            t->printBounces();
+            globals.realTime->printLatency();
+        }
+        prevUs = nowUs;
+
+        t->applyTimings();
+
         for (int control = 0; control < t->controlCount; control++) {
             // Check control rotation
             if (t->gpio[control][Rot1] != INT_MIN) {
-                state = digitalRead(t->gpio[control][Rot1]) + digitalRead(t->gpio[control][Rot2]) * 2;
+                state = globals.hw->readPin(t->gpio[control][Rot1]) + globals.hw->readPin(t->gpio[control][Rot2]) * 2;
                 if (state != t->lastRotateState[control]) {
                     if ((t->lastRotateState[control] == 0 && state == 2) ||
                         (t->lastRotateState[control] == 2 && state == 3) ||
@@ -386,13 +734,16 @@ void watcher(gpioctrl *t)
                         }
                     }
 
+                    if (t->rotateValue[control] % 4 == 0) {
+                        t->detent(control, nowUs);
+                    }
                     t->lastRotateState[control] = state;
                 }
             }
 
             // Check control push
             if (t->gpio[control][Push] != INT_MIN) {
-                state = digitalRead(t->gpio[control][Push]);
+                state = t->debounce(control, DebouncePush, globals.hw->readPin(t->gpio[control][Push]), nowMs);
                 if (state != t->lastPushState[control]) {
                     // If pressed increment value to next even number
                     // otherwise increment value to next odd number.
@@ -404,16 +755,56 @@ void watcher(gpioctrl *t)
                         if (t->pushValue[control] % 2 == 0) t->pushValue[control]++; else t->pushValue[control] += 2;
                     }
 
+                    // Don't report initial state
+                    if (t->lastPushState[control] != -1) {
+                        inputAction action = state == 0 ? PressAction : ReleaseAction;
+                        globals.inputQueue->post({ control, action, GpioInput, t->pushValue[control], 1, nowUs });
+                        t->classifyPush(control, state == 0, nowMs);
+                    }
                     t->lastPushState[control] = state;
                 }
             }
 
+            // Check external push (e.g. SwitchBox)
+            if (t->externalPush[control] != t->lastExternalPush[control]) {
+                t->lastExternalPush[control] = t->externalPush[control];
+                t->classifyPush(control, t->lastExternalPush[control] % 2 == 0, nowMs);
+            }
+
+            t->checkHold(control, nowMs);
+
             // Check control toggle
             if (t->gpio[control][Toggle] != INT_MIN) {
-                t->toggleValue[control] = digitalRead(t->gpio[control][Toggle]);
+                t->toggleValue[control] = t->debounce(control, DebounceToggle, globals.hw->readPin(t->gpio[control][Toggle]), nowMs);
             }
         }
 
-        delay(1);
+        if (fixedPeriod) {
+            // Sleep until next 1ms boundary so sampling period doesn't drift
+            deadline.tv_nsec += 1000000;
+            if (deadline.tv_nsec >= 1000000000) {
+                deadline.tv_nsec -= 1000000000;
+                deadline.tv_sec++;
+            }
+
+            // After an overrun (e.g. preempted) resync rather than
+            // run a burst of back-to-back samples to catch up.
+            timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (deadline.tv_sec < now.tv_sec ||
+                (deadline.tv_sec == now.tv_sec && deadline.tv_nsec < now.tv_nsec))
+            {
+                deadline = now;
+                deadline.tv_nsec += 1000000;
+                if (deadline.tv_nsec >= 1000000000) {
+                    deadline.tv_nsec -= 1000000000;
+                    deadline.tv_sec++;
+                }
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        }
+        else {
+            usleep(1000);
+        }
     }
 }
@@ -3,6 +3,8 @@
 
 #include <climits>
 #include <thread>
+#include <atomic>
+#include <mutex>
 #include "globals.h"
 
 extern globalVars globals;
@@ -18,38 +20,102 @@ enum pinType {
     Led = 4
 };
 
+// Default push thresholds (ms) if not specified in settings
+const int DefaultLongPressMs = 1000;
+const int DefaultHoldRepeatMs = 0;      // 0 = no hold repeat
+const int DefaultDoubleClickMs = 0;     // 0 = no double click
+
+// Debounce slots
+enum debounceSlot {
+    DebouncePush = 0,
+    DebounceToggle = 1
+};
+
+// Default debounce time (ms) if not specified in settings
+const int DefaultDebounceMs = 10;
+
+// Thresholds that can be changed while running (see reloadSettings)
+struct controlTimings {
+    int longPressMs;
+    int holdRepeatMs;
+    int doubleClickMs;
+    int accelMax;       // 1 = no acceleration
+    int accelMs;
+    int debounceMs;
+};
+
+const controlTimings DefaultTimings = {
+    DefaultLongPressMs, DefaultHoldRepeatMs, DefaultDoubleClickMs, 1, 0, DefaultDebounceMs
+};
+
+// Encoder acceleration factors (1-2-5 series so set-points snap to round values)
+const int AccelSteps[] = { 1, 2, 5, 10, 20, 50, 100 };
+const int AccelStepCount = 7;
+
 class gpioctrl
 {
 private:
     std::thread *watcherThread = NULL;
+    bool useCe1 = false;
+
+    // New timings are swapped in by the watcher
+    std::mutex timingMutex;
+    controlTimings pendingTiming[MaxControls];
+    std::atomic<bool> timingPending{ false };
 
 public:
     int controlCount = 0;
+    const char* controlName[MaxControls];
+    const char* controlType[MaxControls];
+    controlTimings timing[MaxControls];
     int gpio[MaxControls][5];   // One slot for each pinType
     int rotateValue[MaxControls];
     int pushValue[MaxControls];
     int toggleValue[MaxControls];
-    int lastRotateValue[MaxControls];
-    int lastPushValue[MaxControls];
+    int lastRotateValue[MaxControls];   // Value at last detent
     int lastRotateState[MaxControls];
     int lastPushState[MaxControls];
     bool clockwise[MaxControls];
+    int externalPush[MaxControls];
+    int lastExternalPush[MaxControls];
+    long long pushDownMs[MaxControls];
+    long long nextHoldMs[MaxControls];
+    long long lastClickMs[MaxControls];
+    bool longPressFired[MaxControls];
+    long long lastDetentMs[MaxControls];
+    int rotateAccel[MaxControls];
+    int rawState[MaxControls][2];
+    int stableState[MaxControls][2];
+    long long rawChangeMs[MaxControls][2];
+    int bounceCount[MaxControls];
 
 public:
-    gpioctrl(bool initWiringPi);
+    gpioctrl(bool initHardware);
     ~gpioctrl();
     int getSetting(const char* control, const char* controlType, const char* attribute);
-    int addControl();
+    int addControl(const char* name);
     int addRotaryEncoder(const char* controlName);
     int addButton(const char* controlName);
     int addSwitch(const char* controlName);
     int addLamp(const char* controlName);
-    int readRotation(int control);
-    int readPush(int control);
+    void start();
+    void setExternalPush(int control, int val);
+    void classifyPush(int control, bool pressed, long long nowMs);
+    void detent(int control, long long nowUs);
+    int debounce(int control, debounceSlot slot, int raw, long long nowMs);
+    void printBounces();
+    void checkHold(int control, long long nowMs);
     void writeLed(int control, bool on);
+    bool checkSettings();
+    void reloadSettings();
+    void applyTimings();
 
 private:
     void validateControl(const char* controlName, int control);
+    bool readTimings(int control, controlTimings* newTiming);
+    bool readPushTimings(int control, controlTimings* newTiming);
+    bool readAcceleration(int control, controlTimings* newTiming);
+    bool readDebounce(int control, controlTimings* newTiming);
     void initPin(int pin, bool isInput);
 };
 
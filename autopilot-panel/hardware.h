@@ -0,0 +1,38 @@
+#ifndef _HARDWARE_H_
+#define _HARDWARE_H_
+
+///
+/// Thin hardware abstraction so the panel can be built and profiled
+/// without a Pi. The backend is chosen at link time:
+///
+///   piHardware.cpp - Real GPIO and SPI using wiringPi (make.sh)
+///   simHardware.cpp - Scripted inputs with outputs captured in
+///                     memory (make-host.sh)
+///
+struct SimVars;
+
+class hardware
+{
+public:
+    virtual ~hardware() {}
+    virtual void setup() = 0;
+    virtual void initPin(int pin, bool isInput) = 0;
+    virtual int readPin(int pin) = 0;
+    virtual void writePin(int pin, int value) = 0;
+    virtual void spiSetup(int channel, int speed) = 0;
+    virtual void spiWrite(int channel, unsigned char* data, int len) = 0;
+
+    // Write a number of frames of the same length, each with its
+    // own chip select cycle, in as few system calls as possible.
+    virtual void spiWriteBatch(int channel, unsigned char* data, int len, int count) = 0;
+
+    // A backend can supply SimVar values in place of the data link.
+    // updateSimVars applies any that are due and returns true if the
+    // aircraft title changed.
+    virtual bool simulatesSimVars() { return false; }
+    virtual bool updateSimVars(SimVars* simVars) { return false; }
+};
+
+hardware* createHardware();
+
+#endif // _HARDWARE_H_
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include "settings.h"
+#include "hotreload.h"
+
+// Wait for writes to settle before reading the file
+const int ReloadDelayMs = 200;
+
+void settingsWatcher(hotreload*);
+
+///
+/// Watches the settings file with inotify and reloads it when it
+/// changes, without restarting the panel.
+///
+/// The file is parsed on the watcher thread. If it is valid the new
+/// settings are handed to the render thread which swaps them in at
+/// the start of the next frame and reloads only the subsystems whose
+/// settings group changed:
+///
+///   Data Link - Host, Port and Rate
+///   GPIO - Push, acceleration and debounce thresholds (pin changes
+///          need a restart)
+///   Layout - Display field positions
+///
+/// Anything else needs a restart. If the new file can't be parsed,
+/// or any of the groups above has an invalid value, all the current
+/// settings are kept.
+///
+
+hotreload::hotreload()
+{
+    strcpy(settingsFile, globals.allSettings->getFileName());
+
+    dataLinkHash = globals.allSettings->groupHash("Data Link");
+    controlsHash = globals.allSettings->groupHash("GPIO");
+    layoutHash = globals.allSettings->groupHash("Layout");
+
+    watcherThread = new std::thread(settingsWatcher, this);
+}
+
+hotreload::~hotreload()
+{
+    if (watcherThread) {
+        // Wait for thread to exit
+        watcherThread->join();
+    }
+
+    delete pendingSettings;
+}
+
+/// <summary>
+/// Called by the render thread. If new settings are waiting and
+/// checkSettings accepts them they replace the current ones and the
+/// subsystems that need to be reloaded are returned (Reload flags),
+/// otherwise 0.
+/// </summary>
+int hotreload::takeChanges(bool (*checkSettings)())
+{
+    std::lock_guard<std::mutex> lock(reloadMutex);
+
+    if (!pendingSettings) {
+        return 0;
+    }
+
+    // Safe to swap as the other threads only read settings during
+    // startup (realtime keeps its own copy of the thread settings).
+    settings* oldSettings = globals.allSettings;
+    globals.allSettings = pendingSettings;
+    pendingSettings = NULL;
+
+    if (!checkSettings()) {
+        // Changed groups stay flagged so they are reloaded
+        // once the file has been fixed.
+        delete globals.allSettings;
+        globals.allSettings = oldSettings;
+        printf("Keeping current settings\n");
+        fflush(stdout);
+        return 0;
+    }
+
+    delete oldSettings;
+
+    int changes = pendingChanges;
+    pendingChanges = 0;
+
+    return changes;
+}
+
+/// <summary>
+/// Parses the changed file and works out which groups differ from
+/// the settings currently in use.
+/// </summary>
+void hotreload::reload()
+{
+    settings* newSettings = new settings(settingsFile, false);
+    if (!newSettings->isLoaded()) {
+        printf("Keeping current settings\n");
+        fflush(stdout);
+        delete newSettings;
+        return;
+    }
+
+    int changes = 0;
+
+    unsigned int hash = newSettings->groupHash("Data Link");
+    if (hash != dataLinkHash) {
+        dataLinkHash = hash;
+        changes |= ReloadDataLink;
+    }
+
+    hash = newSettings->groupHash("GPIO");
+    if (hash != controlsHash) {
+        controlsHash = hash;
+        changes |= ReloadControls;
+    }
+
+    hash = newSettings->groupHash("Layout");
+    if (hash != layoutHash) {
+        layoutHash = hash;
+        changes |= ReloadLayout;
+    }
+
+    std::lock_guard<std::mutex> lock(reloadMutex);
+
+    // Replaces any settings not yet taken
+    delete pendingSettings;
+    pendingSettings = newSettings;
+    pendingChanges |= changes;
+}
+
+/// <summary>
+/// Editors often save by writing a new file and renaming it so the
+/// directory is watched rather than the file itself.
+/// </summary>
+void settingsWatcher(hotreload* t)
+{
+    char dir[256];
+    strcpy(dir, t->settingsFile);
+
+    const char* fileName = t->settingsFile;
+    char* slash = strrchr(dir, '/');
+    if (slash) {
+        fileName = &t->settingsFile[slash - dir + 1];
+        *(slash + 1) = '\0';
+    }
+    else {
+        strcpy(dir, ".");
+    }
+
+    int fd = inotify_init1(IN_NONBLOCK);
+    if (fd == -1 || inotify_add_watch(fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+        printf("Cannot watch %s for changes (settings will not be reloaded)\n", t->settingsFile);
+        fflush(stdout);
+        if (fd != -1) {
+            close(fd);
+        }
+        return;
+    }
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    long long reloadMs = 0;
+
+    while (!globals.quit) {
+        pollfd pfd = { fd, POLLIN, 0 };
+        poll(&pfd, 1, 100);
+
+        int bytes;
+        while ((bytes = read(fd, buf, sizeof(buf))) > 0) {
+            for (char* ptr = buf; ptr < buf + bytes; ) {
+                inotify_event* event = (inotify_event*)ptr;
+                if (event->len > 0 && strcmp(event->name, fileName) == 0) {
+                    reloadMs = monotonicMs() + ReloadDelayMs;
+                }
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        if (reloadMs != 0 && monotonicMs() >= reloadMs) {
+            reloadMs = 0;
+            t->reload();
+        }
+    }
+
+    close(fd);
+}
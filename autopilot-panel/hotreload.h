@@ -0,0 +1,41 @@
+#ifndef _HOTRELOAD_H_
+#define _HOTRELOAD_H_
+
+#include <thread>
+#include <mutex>
+#include "globals.h"
+
+extern globalVars globals;
+
+// Subsystems that can be reloaded while running
+const int ReloadDataLink = 0x01;
+const int ReloadControls = 0x02;
+const int ReloadLayout = 0x04;
+
+class hotreload
+{
+private:
+    std::thread* watcherThread = NULL;
+    char settingsFile[256];
+
+    // Group hashes of the latest accepted settings
+    unsigned int dataLinkHash;
+    unsigned int controlsHash;
+    unsigned int layoutHash;
+
+    // Parsed settings waiting to be swapped in by the render thread
+    std::mutex reloadMutex;
+    settings* pendingSettings = NULL;
+    int pendingChanges = 0;
+
+public:
+    hotreload();
+    ~hotreload();
+    int takeChanges(bool (*checkSettings)());
+
+private:
+    void reload();
+    friend void settingsWatcher(hotreload* t);
+};
+
+#endif // _HOTRELOAD_H_
@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "inputqueue.h"
+
+///
+/// A single queue of input events from every source (GPIO
+/// controls, SwitchBox etc.) so the autopilot only has to handle
+/// each control once, whichever source it came from.
+///
+/// Events are posted by the source threads and taken by the
+/// render thread. Posting wakes the render loop so new input
+/// is shown straight away.
+///
+
+/// <summary>
+/// Adds an event to the queue. Turns of the same encoder at the
+/// same acceleration that haven't been taken yet are combined into
+/// a single event.
+/// </summary>
+void inputqueue::post(const inputEvent& event)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+
+        if (event.action == RotateAction && count > 0) {
+            inputEvent* last = &events[(first + count - 1) % InputQueueSize];
+            if (last->action == RotateAction && last->control == event.control
+                && last->source == event.source && last->accel == event.accel)
+            {
+                // Keep time of earliest detent
+                last->value += event.value;
+                return;
+            }
+        }
+
+        if (count == InputQueueSize) {
+            if (!overflowed) {
+                printf("Input queue full (input lost)\n");
+                fflush(stdout);
+                overflowed = true;
+            }
+            return;
+        }
+
+        events[(first + count) % InputQueueSize] = event;
+        count++;
+    }
+
+    inputReady.notify_one();
+}
+
+/// <summary>
+/// Takes the oldest event. Returns false if there are none.
+/// </summary>
+bool inputqueue::take(inputEvent* event)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+
+    if (count == 0) {
+        overflowed = false;
+        return false;
+    }
+
+    *event = events[first];
+    first = (first + 1) % InputQueueSize;
+    count--;
+
+    return true;
+}
+
+/// <summary>
+/// Waits until there is input or the monotonic time untilUs
+/// is reached. Returns true if there is input.
+/// </summary>
+bool inputqueue::waitForInput(long long untilUs)
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+
+    long long waitUs = untilUs - monotonicUs();
+    if (waitUs > 0 && count == 0) {
+        inputReady.wait_for(lock, std::chrono::microseconds(waitUs),
+            [this] { return count != 0 || globals.quit; });
+    }
+
+    return count != 0;
+}
@@ -0,0 +1,52 @@
+#ifndef _INPUTQUEUE_H_
+#define _INPUTQUEUE_H_
+
+#include <mutex>
+#include <condition_variable>
+#include "globals.h"
+
+extern globalVars globals;
+
+const int InputQueueSize = 64;
+
+enum inputAction {
+    RotateAction,       // value = detents turned (+ = clockwise), accel = step multiplier
+    PressAction,        // value = push count (even = pressed)
+    ReleaseAction,      // value = push count (odd = released)
+    ClickAction,
+    LongPressAction,
+    HoldRepeatAction,
+    DoubleClickAction
+};
+
+enum inputSource {
+    GpioInput,
+    SwitchBoxInput
+};
+
+struct inputEvent {
+    int control;        // Control number (see gpioctrl)
+    inputAction action;
+    inputSource source;
+    int value;
+    int accel;
+    long long timeUs;   // Monotonic time of the input
+};
+
+class inputqueue
+{
+private:
+    std::mutex queueMutex;
+    std::condition_variable inputReady;
+    inputEvent events[InputQueueSize];
+    int first = 0;
+    int count = 0;
+    bool overflowed = false;
+
+public:
+    void post(const inputEvent& event);
+    bool take(inputEvent* event);
+    bool waitForInput(long long untilUs);
+};
+
+#endif // _INPUTQUEUE_H_
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#include <wiringPi.h>
+#include <wiringPiSPI.h>
+#include "piHardware.h"
+
+hardware* createHardware()
+{
+    return new piHardware();
+}
+
+void piHardware::setup()
+{
+    // Use BCM GPIO pin numbers
+    wiringPiSetupGpio();
+}
+
+void piHardware::initPin(int pin, bool isInput)
+{
+    char command[256];
+
+    // NOTE: pullUpDnControl does not work on RasPi4 so have
+    // to use raspi-gpio command line to pull up resistors.
+    if (isInput) {
+        sprintf(command, "raspi-gpio set %d pu", pin);
+    }
+    else {
+        sprintf(command, "raspi-gpio set %d op", pin);
+    }
+
+    if (system(command) != 0) {
+        printf("Failed to run raspi-gpio command\n");
+        exit(1);
+    }
+}
+
+int piHardware::readPin(int pin)
+{
+    return digitalRead(pin);
+}
+
+void piHardware::writePin(int pin, int value)
+{
+    digitalWrite(pin, value);
+}
+
+void piHardware::spiSetup(int channel, int speed)
+{
+    wiringPiSPISetup(channel, speed);
+}
+
+void piHardware::spiWrite(int channel, unsigned char* data, int len)
+{
+    wiringPiSPIDataRW(channel, data, len);
+}
+
+/// <summary>
+/// Submits all the frames to spidev in a single ioctl. Chip select
+/// is released between frames (cs_change) so each one is latched
+/// by the MAX7219s separately.
+/// </summary>
+void piHardware::spiWriteBatch(int channel, unsigned char* data, int len, int count)
+{
+    spi_ioc_transfer transfer[MaxSpiBatch];
+    int fd = wiringPiSPIGetFd(channel);
+
+    while (count > 0) {
+        int batch = count;
+        if (batch > MaxSpiBatch) {
+            batch = MaxSpiBatch;
+        }
+
+        memset(transfer, 0, sizeof(spi_ioc_transfer) * batch);
+        for (int i = 0; i < batch; i++) {
+            transfer[i].tx_buf = (unsigned long)&data[i * len];
+            transfer[i].len = len;
+            transfer[i].bits_per_word = 8;
+
+            // Toggle chip select after every frame except the last
+            // (on the last frame cs_change would keep it selected).
+            transfer[i].cs_change = (i < batch - 1);
+        }
+
+        if (fd < 0 || ioctl(fd, SPI_IOC_MESSAGE(batch), transfer) < 0) {
+            // Fall back to one transfer per frame
+            for (int i = 0; i < batch; i++) {
+                wiringPiSPIDataRW(channel, &data[i * len], len);
+            }
+        }
+
+        data += batch * len;
+        count -= batch;
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef _PIHARDWARE_H_
+#define _PIHARDWARE_H_
+
+#include "hardware.h"
+
+// Max frames per SPI_IOC_MESSAGE ioctl
+const int MaxSpiBatch = 32;
+
+class piHardware : public hardware
+{
+public:
+    void setup();
+    void initPin(int pin, bool isInput);
+    int readPin(int pin);
+    void writePin(int pin, int value);
+    void spiSetup(int channel, int speed);
+    void spiWrite(int channel, unsigned char* data, int len);
+    void spiWriteBatch(int channel, unsigned char* data, int len, int count);
+};
+
+#endif // _PIHARDWARE_H_
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "settings.h"
+#include "realtime.h"
+
+const char* RealtimeGroup = "Realtime";
+const char* ThreadNames[] = { "Watcher", "Data Link", "Render", "SwitchBox" };
+
+///
+/// Optional real-time scheduling for the Pi Zero.
+///
+/// The GPIO watcher samples the rotary encoders every millisecond and
+/// has to compete with the WiFi driver, the data link thread and the
+/// render loop. Real-time mode lets the watcher run with a real-time
+/// scheduling policy, pins each thread to its own CPU and locks the
+/// process into memory so page faults can't stall the watcher.
+///
+/// Settings (all optional, "Realtime" group):
+///   Enabled - 1 to turn on real-time mode
+///   Watcher Policy - FIFO (default), RR or OTHER
+///   Watcher Priority - 1 to 99 (default 50)
+///   Watcher Cpu, Data Link Cpu, Render Cpu, SwitchBox Cpu - CPU to
+///                   pin each thread to (0 to CPU_SETSIZE - 1)
+///   Lock Memory - 1 to lock all memory (mlockall)
+///   Jitter Report - Seconds between sampling interval (plus switch
+///                   bounce and display latency) reports (0 = never)
+///
+
+realtime::realtime()
+{
+    memset(jitterHist, 0, sizeof(jitterHist));
+    memset(latencyHist, 0, sizeof(latencyHist));
+    watcherPolicy = SCHED_FIFO;
+    for (int i = 0; i < Threads; i++) {
+        threadCpu[i] = -1;
+    }
+
+    // Jitter is measured whether or not real-time mode is enabled
+    int val = globals.allSettings->getInt(RealtimeGroup, "Jitter Report");
+    if (val != INT_MIN) {
+        reportSecs = val;
+    }
+
+    enabled = globals.allSettings->getInt(RealtimeGroup, "Enabled") == 1;
+    if (!enabled) {
+        return;
+    }
+
+    char policy[256] = "";
+    globals.allSettings->getString(RealtimeGroup, "Watcher Policy", policy);
+    if (*policy == '\0' || _stricmp(policy, "FIFO") == 0) {
+        watcherPolicy = SCHED_FIFO;
+    }
+    else if (_stricmp(policy, "RR") == 0) {
+        watcherPolicy = SCHED_RR;
+    }
+    else if (_stricmp(policy, "OTHER") == 0) {
+        watcherPolicy = SCHED_OTHER;
+    }
+    else {
+        printf("Invalid Watcher Policy: %s (must be FIFO, RR or OTHER)\n", policy);
+        exit(1);
+    }
+
+    val = globals.allSettings->getInt(RealtimeGroup, "Watcher Priority");
+    if (val != INT_MIN) {
+        watcherPriority = val;
+    }
+
+    if (watcherPolicy != SCHED_OTHER && (watcherPriority < sched_get_priority_min(watcherPolicy)
+        || watcherPriority > sched_get_priority_max(watcherPolicy)))
+    {
+        printf("Invalid Watcher Priority: %d\n", watcherPriority);
+        exit(1);
+    }
+
+    for (int i = 0; i < Threads; i++) {
+        char name[256];
+        snprintf(name, sizeof(name), "%s Cpu", ThreadNames[i]);
+        int cpu = globals.allSettings->getInt(RealtimeGroup, name);
+        if (cpu == INT_MIN) {
+            continue;
+        }
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            printf("Invalid %s: %d (must be 0 to %d)\n", name, cpu, CPU_SETSIZE - 1);
+            exit(1);
+        }
+        threadCpu[i] = cpu;
+    }
+
+    lockMemory = globals.allSettings->getInt(RealtimeGroup, "Lock Memory") == 1;
+    if (lockMemory) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+            printf("Failed to lock memory (need to run as root?)\n");
+        }
+        else {
+            printf("Locked memory\n");
+        }
+    }
+
+    printf("Real-time mode enabled\n");
+}
+
+bool realtime::isEnabled()
+{
+    return enabled;
+}
+
+/// <summary>
+/// Must be called from the thread itself. Pins the thread to the
+/// CPU in settings (if any) and, for the watcher, sets the
+/// real-time scheduling policy.
+/// </summary>
+void realtime::configureThread(const char* threadName)
+{
+    if (!enabled) {
+        return;
+    }
+
+    int cpu = -1;
+    for (int i = 0; i < Threads; i++) {
+        if (strcmp(threadName, ThreadNames[i]) == 0) {
+            cpu = threadCpu[i];
+        }
+    }
+
+    if (cpu != -1) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+            printf("Failed to pin %s thread to CPU %d\n", threadName, cpu);
+        }
+        else {
+            printf("Pinned %s thread to CPU %d\n", threadName, cpu);
+        }
+    }
+
+    if (strcmp(threadName, "Watcher") == 0 && watcherPolicy != SCHED_OTHER) {
+        sched_param param;
+        param.sched_priority = watcherPriority;
+        if (pthread_setschedparam(pthread_self(), watcherPolicy, &param) != 0) {
+            printf("Failed to set real-time priority for %s thread (need to run as root?)\n", threadName);
+        }
+        else {
+            printf("Set real-time priority %d for %s thread\n", watcherPriority, threadName);
+        }
+    }
+
+    fflush(stdout);
+}
+
+/// <summary>
+/// Called by the watcher once per sampling cycle with the actual
+/// time since the previous cycle. Returns true when it is time
+/// to print a report.
+/// </summary>
+bool realtime::addSample(long intervalUs, long long nowMs)
+{
+    int bin = 0;
+    while (intervalUs > JitterBinUs[bin]) {
+        bin++;
+    }
+    jitterHist[bin]++;
+
+    if (intervalUs > jitterMaxUs) {
+        jitterMaxUs = intervalUs;
+    }
+
+    if (reportSecs <= 0) {
+        return false;
+    }
+
+    if (nextReportMs == 0) {
+        nextReportMs = nowMs + reportSecs * 1000;
+    }
+    else if (nowMs >= nextReportMs) {
+        nextReportMs = nowMs + reportSecs * 1000;
+        return true;
+    }
+
+    return false;
+}
+
+void realtime::printJitter()
+{
+    unsigned long total = 0;
+    for (int i = 0; i < JitterBins; i++) {
+        total += jitterHist[i];
+    }
+
+    if (total == 0) {
+        return;
+    }
+
+    printf("Watcher sampling intervals (%lu samples, max %.1f ms):\n", total, jitterMaxUs / 1000.0);
+    long lowerUs = 0;
+    for (int i = 0; i < JitterBins; i++) {
+        if (JitterBinUs[i] == LONG_MAX) {
+            printf("  > %5.1f ms: %lu\n", lowerUs / 1000.0, jitterHist[i]);
+        }
+        else {
+            printf("  <=%5.1f ms: %lu\n", JitterBinUs[i] / 1000.0, jitterHist[i]);
+        }
+        lowerUs = JitterBinUs[i];
+    }
+    fflush(stdout);
+}
+
+/// <summary>
+/// Records the time from an encoder detent to the new value
+/// being written to the displays.
+/// </summary>
+void realtime::addLatency(long latencyUs)
+{
+    std::lock_guard<std::mutex> lock(latencyMutex);
+
+    int bin = 0;
+    while (latencyUs > LatencyBinUs[bin]) {
+        bin++;
+    }
+    latencyHist[bin]++;
+
+    if (latencyUs > latencyMaxUs) {
+        latencyMaxUs = latencyUs;
+    }
+}
+
+void realtime::printLatency()
+{
+    std::lock_guard<std::mutex> lock(latencyMutex);
+
+    unsigned long total = 0;
+    for (int i = 0; i < LatencyBins; i++) {
+        total += latencyHist[i];
+    }
+
+    if (total == 0) {
+        return;
+    }
+
+    printf("Detent to display latency (%lu samples, max %.1f ms):\n", total, latencyMaxUs / 1000.0);
+    long lowerUs = 0;
+    for (int i = 0; i < LatencyBins; i++) {
+        if (LatencyBinUs[i] == LONG_MAX) {
+            printf("  > %5.1f ms: %lu\n", lowerUs / 1000.0, latencyHist[i]);
+        }
+        else {
+            printf("  <=%5.1f ms: %lu\n", LatencyBinUs[i] / 1000.0, latencyHist[i]);
+        }
+        lowerUs = LatencyBinUs[i];
+    }
+    fflush(stdout);
+}
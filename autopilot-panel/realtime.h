@@ -0,0 +1,51 @@
+#ifndef _REALTIME_H_
+#define _REALTIME_H_
+
+#include <climits>
+#include <mutex>
+#include "globals.h"
+
+extern globalVars globals;
+
+// Sampling interval histogram bins (upper limit of each bin in microseconds)
+const int JitterBins = 8;
+const long JitterBinUs[JitterBins] = { 1100, 1500, 2000, 3000, 5000, 10000, 20000, LONG_MAX };
+
+// Detent to display latency histogram bins (microseconds)
+const int LatencyBins = 8;
+const long LatencyBinUs[LatencyBins] = { 1000, 2000, 5000, 10000, 20000, 50000, 100000, LONG_MAX };
+
+class realtime
+{
+private:
+    bool enabled = false;
+    int watcherPolicy;
+    int watcherPriority = 50;
+    bool lockMemory = false;
+    int reportSecs = 0;
+
+    // CPU to pin each thread to (-1 = any). Read once here so the
+    // threads never need to read settings themselves.
+    static const int Threads = 4;
+    int threadCpu[Threads];
+
+    unsigned long jitterHist[JitterBins];
+    long jitterMaxUs = 0;
+    long long nextReportMs = 0;
+
+    // Written by the display writer threads
+    std::mutex latencyMutex;
+    unsigned long latencyHist[LatencyBins];
+    long latencyMaxUs = 0;
+
+public:
+    realtime();
+    bool isEnabled();
+    void configureThread(const char* threadName);
+    bool addSample(long intervalUs, long long nowMs);
+    void printJitter();
+    void addLatency(long latencyUs);
+    void printLatency();
+};
+
+#endif // _REALTIME_H_
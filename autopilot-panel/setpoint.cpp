@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "setpoint.h"
+
+int nextWriteId = 1;
+
+///
+/// A value the panel has written to the sim (speed, heading etc.).
+///
+/// The local value is shown while the write is in flight. As soon as
+/// the sim reports the expected value the write is confirmed and the
+/// sim value is shown again. If the sim hasn't confirmed it within
+/// EchoTimeoutMs it has rejected or clamped the write, so this is
+/// reported and the sim value is shown.
+///
+/// The data link doesn't carry write ids back so writes are
+/// confirmed by value. Only the latest write counts, so echoes of
+/// earlier writes while a knob is being turned are ignored.
+///
+
+setpoint::setpoint(const char* name)
+{
+    this->name = name;
+    echoTimer.expired = [this]() {
+        echoTimeout();
+    };
+}
+
+/// <summary>
+/// Called whenever the value is written. simVar is where the
+/// sim will report it and within is how close it must be.
+/// </summary>
+void setpoint::written(double value, const double* simVar, double within)
+{
+    writeId = nextWriteId++;
+    expected = value;
+    echo = simVar;
+    tolerance = within;
+
+    globals.timerWheel->start(&echoTimer, EchoTimeoutMs);
+}
+
+/// <summary>
+/// Returns true if the sim value should be shown, i.e. there is
+/// no write in flight or the sim has just confirmed it.
+/// </summary>
+bool setpoint::reconcile()
+{
+    if (writeId == 0) {
+        return true;
+    }
+
+    if (fabs(*echo - expected) > tolerance) {
+        return false;
+    }
+
+    writeId = 0;
+    globals.timerWheel->cancel(&echoTimer);
+    return true;
+}
+
+/// <summary>
+/// Forgets any write in flight, e.g. on aircraft change.
+/// </summary>
+void setpoint::clear()
+{
+    writeId = 0;
+    globals.timerWheel->cancel(&echoTimer);
+}
+
+void setpoint::echoTimeout()
+{
+    printf("%s write %d of %g not confirmed by sim (sim has %g)\n", name, writeId, expected, *echo);
+    fflush(stdout);
+
+    writeId = 0;
+}
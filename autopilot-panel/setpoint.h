@@ -0,0 +1,31 @@
+#ifndef _SETPOINT_H_
+#define _SETPOINT_H_
+
+#include "timerwheel.h"
+
+// How long the sim has to confirm a write before it is
+// treated as rejected (covers the altitude/VS retries).
+const int EchoTimeoutMs = 3000;
+
+class setpoint
+{
+private:
+    const char* name;
+    int writeId = 0;            // Write in flight (0 = none)
+    double expected = 0;
+    double tolerance = 0;
+    const double* echo = NULL;  // SimVar the sim should report it in
+    timer echoTimer;
+
+public:
+    setpoint(const char* name);
+    void written(double value, const double* simVar, double within);
+    bool reconcile();
+    void clear();
+    bool inFlight() const { return writeId != 0; }
+
+private:
+    void echoTimeout();
+};
+
+#endif // _SETPOINT_H_
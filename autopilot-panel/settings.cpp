@@ -1,181 +1,768 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "settings.h"
 
-settings::settings(const char* customSettings)
+// FNV-1a hash
+const unsigned int FnvOffset = 2166136261u;
+const unsigned int FnvPrime = 16777619u;
+
+unsigned int hashAdd(unsigned int hash, const char* str)
 {
-    char settingsFile[256];
+    for (; *str != '\0'; str++) {
+        hash = (hash ^ (unsigned char)*str) * FnvPrime;
+    }
 
-    if (customSettings == NULL) {
-        strcpy(settingsFile, globals.SettingsFile);
+    return hash;
+}
+
+unsigned int stringHash(const char* str)
+{
+    return hashAdd(FnvOffset, str);
+}
+
+unsigned int keyHash(const char* group, const char* name)
+{
+    return hashAdd(hashAdd(hashAdd(FnvOffset, group), "\n"), name);
+}
+
+/// <summary>
+/// Returns true if str is the group parts joined with '/'.
+/// </summary>
+bool matchPath(const char* str, const char* const* groupPath, int depth)
+{
+    for (int i = 0; i < depth; i++) {
+        if (i > 0) {
+            if (*str != '/') {
+                return false;
+            }
+            str++;
+        }
+
+        size_t len = strlen(groupPath[i]);
+        if (strncmp(str, groupPath[i], len) != 0) {
+            return false;
+        }
+        str += len;
     }
-    else if (strchr(customSettings, '/') == NULL && strchr(customSettings, '\\') == NULL) {
-        sprintf(settingsFile, "%s%s", globals.SettingsDir, customSettings);
+
+    return *str == '\0';
+}
+
+///
+/// Recursive descent JSON parser. Keys and values are unescaped into
+/// reusable buffers and only copied when they are added to the arena.
+///
+class settingsParser
+{
+public:
+    int line = 1;
+    char error[256] = "";
+
+private:
+    settings* target;
+    const char* pos;
+    const char* end;
+    const char* lineStart;
+    std::vector<char> group;    // Current group path
+    std::vector<char> key;
+    std::vector<char> value;
+
+public:
+    settingsParser(settings* target, const char* data, size_t size);
+    int column();
+    bool parse();
+
+private:
+    bool fail(const char* message);
+    void skipSpace();
+    bool expect(char ch);
+    bool parseObject();
+    bool parseArray();
+    bool parseMember(const char* name);
+    bool parseString(std::vector<char>& str);
+    bool parseLiteral(const char* name);
+    bool parseNumber(const char* name);
+    void pushGroup(const char* name);
+    void popGroup(size_t groupLen);
+};
+
+settingsParser::settingsParser(settings* settingsTarget, const char* data, size_t size)
+{
+    target = settingsTarget;
+    pos = data;
+    end = data + size;
+    lineStart = data;
+
+    group.reserve(256);
+    key.reserve(256);
+    value.reserve(256);
+    group.push_back('\0');
+}
+
+int settingsParser::column()
+{
+    return (int)(pos - lineStart) + 1;
+}
+
+bool settingsParser::parse()
+{
+    skipSpace();
+    if (!expect('{') || !parseObject()) {
+        return false;
     }
-    else {
-        strcpy(settingsFile, customSettings);
+
+    skipSpace();
+    if (pos != end) {
+        return fail("Unexpected text after closing brace");
     }
 
-    printf("Reading %s\n", settingsFile);
+    return true;
+}
 
-    // Load settings from JSON file
-    static char buf[16384] = { '\0' };
+bool settingsParser::fail(const char* message)
+{
+    if (*error == '\0') {
+        strncpy(error, message, sizeof(error) - 1);
+    }
 
-    // Read file in a single chunk
-    FILE* infile = fopen(settingsFile, "r");
-    if (infile) {
-        int bytes = (int)fread(buf, 1, 16384, infile);
-        buf[bytes] = '\0';
-        fclose(infile);
+    return false;
+}
+
+void settingsParser::skipSpace()
+{
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r' || *pos == '\n')) {
+        if (*pos == '\n') {
+            line++;
+            lineStart = pos + 1;
+        }
+        pos++;
     }
-    else {
-        printf("Settings file %s not found\n", settingsFile);
-        exit(1);
+}
+
+bool settingsParser::expect(char ch)
+{
+    if (pos == end) {
+        char message[64];
+        sprintf(message, "Expected '%c' but reached end of file", ch);
+        return fail(message);
     }
 
-    char parent[8][256];
-    int level = 0;
+    if (*pos != ch) {
+        char message[64];
+        sprintf(message, "Expected '%c' but found '%c'", ch, *pos);
+        return fail(message);
+    }
 
-    int pos = 0;
-    char ch;
-    while ((ch = buf[pos]) != '\0') {
-        if (ch == '{') {
-            if (level > 6) {
-                printf("Level too deep: %s\n", &buf[pos]);
-                exit(1);
-            }
-            level++;
-            pos++;
+    pos++;
+    return true;
+}
+
+/// <summary>
+/// Called after the opening brace.
+/// </summary>
+bool settingsParser::parseObject()
+{
+    skipSpace();
+    if (pos < end && *pos == '}') {
+        pos++;
+        return true;
+    }
+
+    while (true) {
+        skipSpace();
+        if (!parseString(key)) {
+            return false;
         }
-        else if (ch == '}') {
-            if (level == 0) {
-                printf("Mismatched bracket: %s\n", &buf[pos]);
-                exit(1);
-            }
-            level--;
+
+        if (key.size() == 1) {
+            return fail("Empty name");
+        }
+
+        skipSpace();
+        if (!expect(':')) {
+            return false;
+        }
+
+        skipSpace();
+        if (!parseMember(key.data())) {
+            return false;
+        }
+
+        skipSpace();
+        if (pos < end && *pos == ',') {
             pos++;
+            continue;
         }
-        else if (ch == '"') {
-            // Read attribute name
-            char name[256];
-            readString(buf, &pos, name);
 
-            if (buf[pos] != ':') {
-                printf("missing colon: ");
-                exit(1);
-            }
+        return expect('}');
+    }
+}
+
+/// <summary>
+/// Called after the opening bracket.
+/// </summary>
+bool settingsParser::parseArray()
+{
+    skipSpace();
+    if (pos < end && *pos == ']') {
+        pos++;
+        return true;
+    }
+
+    for (int index = 0; ; index++) {
+        char name[16];
+        sprintf(name, "%d", index);
+
+        skipSpace();
+        if (!parseMember(name)) {
+            return false;
+        }
+
+        skipSpace();
+        if (pos < end && *pos == ',') {
             pos++;
+            continue;
+        }
+
+        return expect(']');
+    }
+}
+
+/// <summary>
+/// Parses a value and adds it to the current group with the given
+/// name. name may point into the key buffer so it must be used
+/// before the key buffer is reused.
+/// </summary>
+bool settingsParser::parseMember(const char* name)
+{
+    if (pos == end) {
+        return fail("Expected a value but reached end of file");
+    }
+
+    size_t groupLen = group.size();
+
+    switch (*pos) {
+    case '{':
+        pos++;
+        pushGroup(name);
+        if (!parseObject()) {
+            return false;
+        }
+        popGroup(groupLen);
+        return true;
+
+    case '[':
+        pos++;
+        pushGroup(name);
+        if (!parseArray()) {
+            return false;
+        }
+        popGroup(groupLen);
+        return true;
+
+    case '"':
+        if (!parseString(value)) {
+            return false;
+        }
+        target->add(group.data(), name, value.data(), false);
+        return true;
 
-            char value[256];
-            readValue(buf, &pos, value);
+    case 't':
+    case 'f':
+    case 'n':
+        return parseLiteral(name);
 
-            if (strcmp(value, "{") == 0) {
-                strcpy(parent[level], name);
+    default:
+        return parseNumber(name);
+    }
+}
+
+bool settingsParser::parseString(std::vector<char>& str)
+{
+    if (!expect('"')) {
+        return false;
+    }
+
+    str.clear();
+
+    while (true) {
+        if (pos == end || *pos == '\n') {
+            return fail("Missing end quote");
+        }
+
+        char ch = *pos++;
+
+        if (ch == '"') {
+            break;
+        }
+
+        if (ch == '\\') {
+            if (pos == end) {
+                return fail("Missing end quote");
             }
-            else {
-                // Store new value
-                char group[256];
-                strcpy(group, parent[1]);
-
-                for (int i = 2; i < level; i++) {
-                    strcat(group, "/");
-                    strcat(group, parent[i]);
+
+            ch = *pos++;
+            switch (ch) {
+            case '"':
+            case '\\':
+            case '/':
+                break;
+            case 'b':
+                ch = '\b';
+                break;
+            case 'f':
+                ch = '\f';
+                break;
+            case 'n':
+                ch = '\n';
+                break;
+            case 'r':
+                ch = '\r';
+                break;
+            case 't':
+                ch = '\t';
+                break;
+            case 'u':
+            {
+                if (end - pos < 4) {
+                    return fail("Bad unicode escape");
+                }
+                char hex[5] = { pos[0], pos[1], pos[2], pos[3], '\0' };
+                char* hexEnd;
+                long code = strtol(hex, &hexEnd, 16);
+                if (*hexEnd != '\0') {
+                    return fail("Bad unicode escape");
                 }
+                pos += 4;
 
-                add(group, name, value);
+                // Only ASCII is needed for settings
+                ch = code < 0x80 ? (char)code : '?';
+                break;
+            }
+            default:
+                pos--;
+                return fail("Bad escape sequence");
             }
         }
-        else {
-            // Ignore char
-            pos++;
-        }
+
+        str.push_back(ch);
     }
+
+    str.push_back('\0');
+    return true;
 }
 
-void settings::readString(char* buf, int* pos, char* str)
+bool settingsParser::parseLiteral(const char* name)
 {
-    char ch;
+    if (end - pos >= 4 && strncmp(pos, "true", 4) == 0) {
+        pos += 4;
+        target->add(group.data(), name, "true", false);
+        return true;
+    }
 
-    (*pos)++;
-    int nameStart = *pos;
+    if (end - pos >= 5 && strncmp(pos, "false", 5) == 0) {
+        pos += 5;
+        target->add(group.data(), name, "false", false);
+        return true;
+    }
 
-    while ((ch = buf[*pos]) != '"') {
-        if (ch == '\0') {
-            printf("Missing end quote: %s\n", &buf[nameStart - 1]);
-            exit(1);
-        }
-        (*pos)++;
+    if (end - pos >= 4 && strncmp(pos, "null", 4) == 0) {
+        // Same as not specifying the setting
+        pos += 4;
+        return true;
     }
 
-    int nameLen = *pos - nameStart;
+    return fail("Expected a value");
+}
 
-    if (nameLen == 0 || nameLen > 64) {
-        printf("Bad string: %s\n", &buf[nameStart - 1]);
-        exit(1);
+bool settingsParser::parseNumber(const char* name)
+{
+    const char* start = pos;
+
+    if (pos < end && *pos == '-') {
+        pos++;
     }
 
-    strncpy(str, &buf[nameStart], nameLen);
-    str[nameLen] = '\0';
-    (*pos)++;
+    while (pos < end && ((*pos >= '0' && *pos <= '9') || *pos == '.' || *pos == 'e' || *pos == 'E' || *pos == '+' || *pos == '-')) {
+        pos++;
+    }
+
+    value.assign(start, pos);
+    value.push_back('\0');
+
+    char* numEnd;
+    strtod(value.data(), &numEnd);
+    if (pos == start || *numEnd != '\0') {
+        pos = start;
+        return fail("Expected a value");
+    }
+
+    target->add(group.data(), name, value.data(), true);
+    return true;
+}
+
+void settingsParser::pushGroup(const char* name)
+{
+    // Replace terminator with separator
+    group.pop_back();
+    if (!group.empty()) {
+        group.push_back('/');
+    }
+    group.insert(group.end(), name, name + strlen(name));
+    group.push_back('\0');
 }
 
-void settings::readValue(char* buf, int* pos, char* value)
+void settingsParser::popGroup(size_t groupLen)
 {
-    char ch;
+    group.resize(groupLen);
+    group.back() = '\0';
+}
+
+///
+/// Settings are read from a JSON file in a single pass. The file is
+/// mapped into memory rather than copied so there is no size limit.
+///
+/// Nested objects become groups joined with '/', e.g. the Rot1 pin
+/// of the speed encoder is group "GPIO/Speed/RotaryEncoder", name
+/// "Rot1". Arrays are treated as groups with elements named by their
+/// index ("0", "1", ...). Strings, integers, floats, booleans (read as
+/// 1 or 0) and null (ignored) are supported. Errors are reported with
+/// the line and column.
+///
 
-    while ((ch = buf[*pos]) == ' ') {
-        (*pos)++;
+/// <summary>
+/// Converting a double that doesn't fit in an int is undefined so
+/// out of range values (and NaN) read as INT_MIN, i.e. not set.
+/// </summary>
+int toInt(double value)
+{
+    if (value > INT_MIN && value < INT_MAX + 1.0) {
+        return (int)value;
     }
 
-    if (ch == '\0' || ch == '\r' || ch == '\n') {
-        printf("Line must end with a value or an opening curly brace");
-        exit(1);
+    return INT_MIN;
+}
+
+/// <summary>
+/// Parses the settings file. If the file can't be loaded the error is
+/// displayed and the program exits unless exitOnError is false, in
+/// which case isLoaded() returns false.
+/// </summary>
+settings::settings(const char* customSettings, bool exitOnError)
+{
+    int len;
+    if (customSettings == NULL) {
+        len = snprintf(settingsFile, sizeof(settingsFile), "%s", globals.SettingsFile);
+    }
+    else if (strchr(customSettings, '/') == NULL && strchr(customSettings, '\\') == NULL) {
+        len = snprintf(settingsFile, sizeof(settingsFile), "%s%s", globals.SettingsDir, customSettings);
+    }
+    else {
+        len = snprintf(settingsFile, sizeof(settingsFile), "%s", customSettings);
     }
 
-    if (ch == '{') {
-        strcpy(value, "{");
-        return;
+    if (len < 0 || len >= (int)sizeof(settingsFile)) {
+        printf("Settings file name is too long: %s\n", customSettings);
+        loaded = false;
+    }
+    else {
+        printf("Reading %s\n", settingsFile);
+        loaded = load();
     }
 
-    if (ch == '"') {
-        readString(buf, pos, value);
-        return;
+    if (!loaded && exitOnError) {
+        exit(1);
     }
+}
 
-    int val = atoi(&buf[*pos]);
-    sprintf(value, "%d", val);
+bool settings::isLoaded()
+{
+    return loaded;
+}
 
-    // No need to skip over value as main loop will do that
+const char* settings::getFileName()
+{
+    return settingsFile;
 }
 
-void settings::add(const char *group, const char *name, char *value)
+bool settings::load()
 {
-    strcpy(allSettings[settingCount].group, group);
-    strcpy(allSettings[settingCount].name, name);
-    strcpy(allSettings[settingCount].value, value);
-    settingCount++;
+    int fd = open(settingsFile, O_RDONLY);
+    if (fd == -1) {
+        printf("Settings file %s not found\n", settingsFile);
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        printf("Settings file %s is empty\n", settingsFile);
+        close(fd);
+        return false;
+    }
+
+    size_t size = fileStat.st_size;
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        printf("Cannot read settings file %s\n", settingsFile);
+        return false;
+    }
+
+    // Strings can't take up more room than the file itself
+    arena.reserve(size);
+
+    settingsParser parser(this, (const char*)data, size);
+    bool success = parser.parse();
+    munmap(data, size);
+
+    if (!success) {
+        printf("%s:%d:%d: %s\n", settingsFile, parser.line, parser.column(), parser.error);
+    }
+
+    return success;
 }
 
-void settings::getString(const char* group, const char* name, char* str)
+/// <summary>
+/// Settings are stored as strings interned in a single arena with
+/// an open-addressed hash table keyed by (group, name). Numbers and
+/// booleans (1 or 0) are converted once when the file is loaded.
+/// </summary>
+void settings::add(const char *group, const char *name, const char *value, bool isNumber)
 {
-    for (int i = 0; i < settingCount; i++) {
-        if (strcmp(allSettings[i].group, group) == 0 && strcmp(allSettings[i].name, name) == 0) {
-            strcpy(str, allSettings[i].value);
+    setting newSetting;
+    newSetting.group = intern(group);
+    newSetting.name = intern(name);
+    newSetting.value = intern(value);
+    newSetting.hash = keyHash(group, name);
+
+    if (isNumber) {
+        newSetting.doubleValue = atof(value);
+        newSetting.intValue = toInt(newSetting.doubleValue);
+    }
+    else if (strcmp(value, "true") == 0) {
+        newSetting.doubleValue = 1;
+        newSetting.intValue = 1;
+    }
+    else if (strcmp(value, "false") == 0) {
+        newSetting.doubleValue = 0;
+        newSetting.intValue = 0;
+    }
+    else {
+        // Strings are converted in the same way as atoi (but range checked)
+        newSetting.doubleValue = atof(value);
+        long longValue = strtol(value, NULL, 10);
+        newSetting.intValue = (longValue > INT_MIN && longValue <= INT_MAX) ? (int)longValue : INT_MIN;
+    }
+
+    // Keep table no more than half full
+    if ((int)(allSettings.size() + 1) * 2 > (int)settingSlots.size()) {
+        growSettingSlots();
+    }
+
+    int mask = (int)settingSlots.size() - 1;
+    int slot = newSetting.hash & mask;
+    while (settingSlots[slot] != -1) {
+        setting* existing = &allSettings[settingSlots[slot]];
+        if (existing->hash == newSetting.hash && existing->group == newSetting.group && existing->name == newSetting.name) {
+            // First value wins
             return;
         }
+        slot = (slot + 1) & mask;
+    }
+
+    settingSlots[slot] = (int)allSettings.size();
+    allSettings.push_back(newSetting);
+}
+
+void settings::growSettingSlots()
+{
+    int size = settingSlots.empty() ? 64 : (int)settingSlots.size() * 2;
+    settingSlots.assign(size, -1);
+
+    int mask = size - 1;
+    for (int i = 0; i < (int)allSettings.size(); i++) {
+        int slot = allSettings[i].hash & mask;
+        while (settingSlots[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+        settingSlots[slot] = i;
+    }
+}
+
+/// <summary>
+/// Returns the arena offset of the string, adding it if it
+/// isn't there already. Each distinct string is only stored once.
+/// </summary>
+int settings::intern(const char* str)
+{
+    if ((internCount + 1) * 2 > (int)internSlots.size()) {
+        growInternSlots();
+    }
+
+    int mask = (int)internSlots.size() - 1;
+    int slot = stringHash(str) & mask;
+    while (internSlots[slot] != -1) {
+        if (strcmp(&arena[internSlots[slot]], str) == 0) {
+            return internSlots[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    int offset = (int)arena.size();
+    arena.insert(arena.end(), str, str + strlen(str) + 1);
+
+    internSlots[slot] = offset;
+    internCount++;
+
+    return offset;
+}
+
+void settings::growInternSlots()
+{
+    std::vector<int> oldSlots;
+    oldSlots.swap(internSlots);
+
+    int size = oldSlots.empty() ? 256 : (int)oldSlots.size() * 2;
+    internSlots.assign(size, -1);
+
+    int mask = size - 1;
+    for (int offset : oldSlots) {
+        if (offset != -1) {
+            int slot = stringHash(&arena[offset]) & mask;
+            while (internSlots[slot] != -1) {
+                slot = (slot + 1) & mask;
+            }
+            internSlots[slot] = offset;
+        }
+    }
+}
+
+/// <summary>
+/// Returns a handle for the setting or NoSetting if it doesn't exist.
+/// Handles stay valid so a setting that is read repeatedly only needs
+/// to be looked up once.
+/// </summary>
+settingHandle settings::find(const char* group, const char* name)
+{
+    return find(&group, 1, name);
+}
+
+/// <summary>
+/// Same as find(group, name) but the group is given as separate parts,
+/// e.g. { "GPIO", "Speed", "RotaryEncoder" } for "GPIO/Speed/RotaryEncoder",
+/// so the caller doesn't have to build the path.
+/// </summary>
+settingHandle settings::find(const char* const* groupPath, int depth, const char* name)
+{
+    if (settingSlots.empty()) {
+        return NoSetting;
+    }
+
+    unsigned int hash = FnvOffset;
+    for (int i = 0; i < depth; i++) {
+        if (i > 0) {
+            hash = hashAdd(hash, "/");
+        }
+        hash = hashAdd(hash, groupPath[i]);
+    }
+    hash = hashAdd(hash, "\n");
+    hash = hashAdd(hash, name);
+
+    int mask = (int)settingSlots.size() - 1;
+    int slot = hash & mask;
+    while (settingSlots[slot] != -1) {
+        setting* existing = &allSettings[settingSlots[slot]];
+        if (existing->hash == hash && strcmp(&arena[existing->name], name) == 0
+            && matchPath(&arena[existing->group], groupPath, depth)) {
+            return settingSlots[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    return NoSetting;
+}
+
+/// <summary>
+/// Returns the value of the setting or NULL if there is no such setting.
+/// </summary>
+const char* settings::getString(settingHandle handle)
+{
+    if (handle == NoSetting) {
+        return NULL;
     }
 
-    str = NULL;
+    return &arena[allSettings[handle].value];
+}
+
+/// <summary>
+/// Returns the value of the setting or INT_MIN if there is no such setting.
+/// </summary>
+int settings::getInt(settingHandle handle)
+{
+    if (handle == NoSetting) {
+        return INT_MIN;
+    }
+
+    return allSettings[handle].intValue;
+}
+
+/// <summary>
+/// Returns the value of the setting or NAN if there is no such setting.
+/// </summary>
+double settings::getDouble(settingHandle handle)
+{
+    if (handle == NoSetting) {
+        return NAN;
+    }
+
+    return allSettings[handle].doubleValue;
+}
+
+void settings::getString(const char* group, const char* name, char* str)
+{
+    const char* value = getString(find(group, name));
+
+    if (value != NULL) {
+        strcpy(str, value);
+    }
 }
 
 int settings::getInt(const char* group, const char* name)
 {
-    for (int i = 0; i < settingCount; i++) {
-        if (strcmp(allSettings[i].group, group) == 0 && strcmp(allSettings[i].name, name) == 0) {
-            return atoi(allSettings[i].value);
+    return getInt(find(group, name));
+}
+
+double settings::getDouble(const char* group, const char* name)
+{
+    return getDouble(find(group, name));
+}
+
+/// <summary>
+/// Returns a hash of every setting in the group (including sub-groups)
+/// so two versions of the settings file can be compared a group at a
+/// time.
+/// </summary>
+unsigned int settings::groupHash(const char* group)
+{
+    size_t groupLen = strlen(group);
+    unsigned int hash = 0;
+
+    for (setting& entry : allSettings) {
+        const char* entryGroup = &arena[entry.group];
+        if (strncmp(entryGroup, group, groupLen) == 0
+            && (entryGroup[groupLen] == '\0' || entryGroup[groupLen] == '/')) {
+            // Order of settings doesn't matter
+            hash += hashAdd(hashAdd(entry.hash, "\n"), &arena[entry.value]);
         }
     }
 
-    return INT_MIN;
+    return hash;
 }
+
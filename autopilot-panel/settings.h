@@ -2,31 +2,58 @@
 #define _SETTINGS_H_
 
 #include <climits>
+#include <vector>
 #include "globals.h"
 
 extern globalVars globals;
 
+// Stable reference to a setting so it can be read without a lookup
+typedef int settingHandle;
+const settingHandle NoSetting = -1;
+
 struct setting {
-    char group[256];
-    char name[256];
-    char value[256];
+    int group;          // Offsets of interned strings in the arena
+    int name;
+    int value;
+    int intValue;       // Parsed once at load
+    double doubleValue;
+    unsigned int hash;
 };
 
+class settingsParser;
+
 class settings
 {
 private:
-    int settingCount = 0;
-    setting allSettings[256];
+    char settingsFile[256];
+    bool loaded = false;
+    std::vector<char> arena;
+    std::vector<setting> allSettings;
+    std::vector<int> settingSlots;      // Open-addressed index of allSettings (-1 = empty)
+    std::vector<int> internSlots;       // Open-addressed arena offsets of strings (-1 = empty)
+    int internCount = 0;
 
 public:
-    settings(const char* settingsFile);
+    settings(const char* settingsFile, bool exitOnError = true);
+    bool isLoaded();
+    const char* getFileName();
+    settingHandle find(const char* group, const char* name);
+    settingHandle find(const char* const* groupPath, int depth, const char* name);
+    const char* getString(settingHandle handle);
+    int getInt(settingHandle handle);
+    double getDouble(settingHandle handle);
     void getString(const char* group, const char* name, char* str);
     int getInt(const char* group, const char* name);
+    double getDouble(const char* group, const char* name);
+    unsigned int groupHash(const char* group);
 
 private:
-    void readString(char* buf, int* pos, char* name);
-    void readValue(char* buf, int* pos, char* value);
-    void add(const char* group, const char* name, char* value);
+    bool load();
+    void add(const char* group, const char* name, const char* value, bool isNumber);
+    int intern(const char* str);
+    void growSettingSlots();
+    void growInternSlots();
+    friend class settingsParser;
 };
 
 #endif // _SETTINGS_H_
@@ -2,10 +2,44 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <wiringPi.h>
-#include <wiringPiSPI.h>
+#include "settings.h"
+#include "realtime.h"
+#include "hardware.h"
 #include "sevensegment.h"
 
+const char* DisplayGroup = "Display";
+
+// How long to show hyphens at startup
+const int SelfTestMs = 1500;
+
+// MAX7219 register/value pairs (written to every display in the chain)
+const unsigned char InitRegs[][2] = {
+    { 0x0f, 0x00 },     // Display test off
+    { 0x0c, 0x01 },     // Normal operation
+    { 0x0a, 0x03 },     // Intensity
+    { 0x09, 0xff },     // Code B decode for all digits
+    { 0x0b, 0x07 }      // Scan all 8 digits
+};
+const int InitRegCount = sizeof(InitRegs) / sizeof(InitRegs[0]);
+
+const unsigned char HyphenRegs[][2] = {
+    { 0x01, 0x0a }, { 0x02, 0x0a }, { 0x03, 0x0a }, { 0x04, 0x0a },
+    { 0x05, 0x0a }, { 0x06, 0x0a }, { 0x07, 0x0a }, { 0x08, 0x0a }
+};
+
+const unsigned char BlankRegs[][2] = {
+    { 0x01, 0x0f }, { 0x02, 0x0f }, { 0x03, 0x0f }, { 0x04, 0x0f },
+    { 0x05, 0x0f }, { 0x06, 0x0f }, { 0x07, 0x0f }, { 0x08, 0x0f }
+};
+const int DigitRegCount = 8;
+
+// Most register writes sent by writeRegs in one batch
+const int MaxRegWrites = 8;
+static_assert(InitRegCount <= MaxRegWrites, "Too many init registers");
+static_assert(DigitRegCount <= MaxRegWrites, "Too many digit registers");
+
+void displayWriter(sevensegment*, displayChain*);
+
 ///
 /// This class allows you to drive a daisy-chained
 /// set of 8 digit 7-segment displays using SPI.
@@ -27,44 +61,126 @@
 /// edit /boot/config.txt and add "dtoverlay=spi0-1cs,no_miso".
 /// Don't use "dtparm=spi=on" as this uses up 2 extra pins.
 ///
+/// A second chain can be connected to CS - GPIO 7 (CE1) = Pin 26.
+/// In that case use "dtoverlay=spi0-2cs,no_miso" instead.
+///
 
 /// <summary>
-/// Specify Channel 0 if using CE0 or channel 1 if using CE1.
+/// Displays are configured per chip select in the Display group,
+/// e.g. "CE0 Displays": 3 and "CE1 Displays": 2. Displays are
+/// numbered left to right across CE0 then CE1. Defaults to
+/// 3 displays on CE0.
 /// </summary>
-sevensegment::sevensegment(bool initWiringPi, int spiChannel)
+sevensegment::sevensegment(bool initHardware)
 {
-    char hex[256];
+    // Caller may want to initialise hardware themselves
+    if (initHardware) {
+        globals.hw->setup();
+    }
+
+    int ce0Displays = globals.allSettings->getInt(DisplayGroup, "CE0 Displays");
+    int ce1Displays = globals.allSettings->getInt(DisplayGroup, "CE1 Displays");
+
+    if (ce0Displays == INT_MIN && ce1Displays == INT_MIN) {
+        ce0Displays = 3;
+    }
 
-    channel = spiChannel;
+    addChain(0, ce0Displays);
+    addChain(1, ce1Displays);
 
-    // Caller may want to initialise wiringPi themselves
-    if (initWiringPi) {
-        // Init wiring pi, needed for delayMicroseconds
-        wiringPiSetupGpio();
+    if (chainCount == 0) {
+        printf("No displays specified in %s settings\n", DisplayGroup);
+        exit(1);
     }
 
-    // Init wiring pi SPI, get corruption at 10 MHz so use 1 MHz
-    wiringPiSPISetup(channel, 1000000);
-
-    // Intialise all 3 displays. Displays hyphens to show
-    // displays have been initialised successfully.
-    strcpy(hex, "0f000c010a0309ff0b07010a020a030a040a050a060a070a080a");
-    writeSegHex(1, hex);
-    writeSegHex(2, hex);
-    writeSegHex(3, hex);
-
-    // Clear displays after a short delay
-    delayMicroseconds(1500000);
-    strcpy(hex, "010f020f030f040f050f060f070f080f");
-    writeSegHex(1, hex);
-    writeSegHex(2, hex);
-    writeSegHex(3, hex);
-
-    for (int i = 0; i < 3; i++) {
-        for (int j = 0; j < 8; j++) {
-            prevDisplay[i][j] = 0x0f;
+    // A corrupted register is repaired by the scrubber within a
+    // few hundred ms so the bus can be run faster than 1 MHz.
+    int val = globals.allSettings->getInt(DisplayGroup, "SPI Speed");
+    if (val != INT_MIN) {
+        spiSpeed = val;
+    }
+
+    val = globals.allSettings->getInt(DisplayGroup, "Scrub Ms");
+    if (val != INT_MIN) {
+        scrubMs = val;
+    }
+
+    // Self test shows hyphens at startup to show displays
+    // have been initialised successfully (on by default).
+    selfTest = globals.allSettings->getInt(DisplayGroup, "Self Test") != 0;
+
+    for (int i = 0; i < chainCount; i++) {
+        displayChain* chain = &chains[i];
+
+        globals.hw->spiSetup(chain->channel, spiSpeed);
+
+        // Intialise all displays in the chain. Doesn't wait for the
+        // self test as the writer thread clears the hyphens later.
+        writeRegs(chain, InitRegs, InitRegCount);
+        if (selfTest) {
+            writeRegs(chain, HyphenRegs, DigitRegCount);
+        }
+        else {
+            writeRegs(chain, BlankRegs, DigitRegCount);
         }
+
+        for (int display = 0; display < chain->displays; display++) {
+            for (int j = 0; j < 8; j++) {
+                chain->prevDisplay[display][j] = 0x0f;
+            }
+        }
+    }
+
+    // Each chip select has its own writer thread so
+    // chains are written concurrently.
+    for (int i = 0; i < chainCount; i++) {
+        chains[i].writerThread = new std::thread(displayWriter, this, &chains[i]);
+    }
+}
+
+sevensegment::~sevensegment()
+{
+    for (int i = 0; i < chainCount; i++) {
+        if (chains[i].writerThread) {
+            // Tell thread to stop and wait for it to exit
+            {
+                std::lock_guard<std::mutex> lock(chains[i].frameMutex);
+                chains[i].stop = true;
+            }
+            chains[i].frameReady.notify_one();
+            chains[i].writerThread->join();
+            delete chains[i].writerThread;
+            chains[i].writerThread = NULL;
+        }
+    }
+}
+
+void sevensegment::addChain(int channel, int displays)
+{
+    if (displays == INT_MIN || displays == 0) {
+        return;
+    }
+
+    if (displays < 0 || displays > MaxChainDisplays) {
+        printf("Invalid number of displays on CE%d, maximum is %d\n", channel, MaxChainDisplays);
+        exit(1);
     }
+
+    displayChain* chain = &chains[chainCount];
+    chain->channel = channel;
+    chain->displays = displays;
+    chain->firstDisplay = displayCount;
+
+    chainCount++;
+    displayCount += displays;
+}
+
+/// <summary>
+/// Total number of displays across all chains.
+/// </summary>
+int sevensegment::getDisplayCount()
+{
+    return displayCount;
 }
 
 /// <summary>
@@ -182,80 +298,202 @@ void sevensegment::decimalSegData(unsigned char* buf, int pos)
 }
 
 /// <summary>
-/// Write hex data to the specified display.
-/// Note: display 1 is right-most display.
+/// Write the same register values to all displays in a chain. Each
+/// register write goes to every display in a single transfer.
 /// </summary>
-void sevensegment::writeSegHex(int display, char* hex)
+void sevensegment::writeRegs(displayChain* chain, const unsigned char regs[][2], int regCount)
 {
-    unsigned char regData[6];
-    int strLen = strlen(hex);
-    char ch;
-    int num;
-
-    for (int i = 0; i < strLen; i += 4) {
-        ch = hex[i + 4];
-        hex[i + 4] = '\0';
-        num = strtol(&hex[i], NULL, 16);
-        hex[i + 4] = ch;
-
-        int dataLen = 0;
-        for (int j = 1; j <= 3; j++) {
-            if (j == display) {
-                regData[dataLen] = (num & 0xff00) >> 8;
-                regData[dataLen + 1] = num & 0x00ff;
+    unsigned char frames[MaxRegWrites * MaxChainDisplays * 2];
+    int len = chain->displays * 2;
+
+    if (regCount > MaxRegWrites) {
+        regCount = MaxRegWrites;
+    }
+
+    for (int i = 0; i < regCount; i++) {
+        for (int slot = 0; slot < chain->displays; slot++) {
+            frames[i * len + slot * 2] = regs[i][0];
+            frames[i * len + slot * 2 + 1] = regs[i][1];
+        }
+    }
+
+    globals.hw->spiWriteBatch(chain->channel, frames, len, regCount);
+}
+
+/// <summary>
+/// Takes complete data buffers (8 chars each) for bufCount displays,
+/// numbered left to right across all chains, and queues them to be
+/// written by the writer threads so the caller doesn't have to wait
+/// for SPI. If a writer is still busy with an earlier frame only the
+/// latest frame is kept.
+/// inputUs is the time of the encoder detent that caused the frame
+/// (if any) so detent to display latency can be measured.
+/// </summary>
+void sevensegment::submitFrame(unsigned char* const* bufs, int bufCount, long long inputUs)
+{
+    for (int i = 0; i < chainCount; i++) {
+        displayChain* chain = &chains[i];
+        bool changed = false;
+
+        {
+            std::lock_guard<std::mutex> lock(chain->frameMutex);
+            for (int display = 0; display < chain->displays; display++) {
+                int index = chain->firstDisplay + display;
+                if (index < bufCount) {
+                    memcpy(chain->pendingFrame[display], bufs[index], 8);
+                    changed = true;
+                }
             }
-            else {
-                // No-op for this display
-                regData[dataLen] = 0;
-                regData[dataLen + 1] = 0;
+
+            if (changed) {
+                chain->framePending = true;
+
+                // Measure from the earliest detent not yet displayed
+                if (inputUs != 0 && chain->pendingInputUs == 0) {
+                    chain->pendingInputUs = inputUs;
+                }
+            }
+        }
+
+        if (changed) {
+            chain->frameReady.notify_one();
+        }
+    }
+}
+
+/// <summary>
+/// Writes a complete frame (8 chars per display) to a chain.
+/// Only digits that have changed are written. A transfer carries
+/// one changed digit for every display in the chain (no-op for
+/// displays with nothing left to change) so the number of transfers
+/// is the most digits changed on any one display, all submitted
+/// together in a single batch. Returns true if anything was written.
+/// </summary>
+bool sevensegment::writeSegData(displayChain* chain, unsigned char frame[][8])
+{
+    unsigned char frames[8 * MaxChainDisplays * 2];
+    int len = chain->displays * 2;
+    int frameCount = 0;
+
+    // Register 0 is a no-op
+    memset(frames, 0, 8 * len);
+
+    for (int display = 0; display < chain->displays; display++) {
+        // Slot 0 is the last display (rightmost) in the chain
+        int slot = chain->displays - 1 - display;
+        int changes = 0;
+
+        for (int i = 0; i < 8; i++) {
+            if (frame[display][i] != chain->prevDisplay[display][i]) {
+                chain->prevDisplay[display][i] = frame[display][i];
+
+                // 1 = rightmost digit
+                frames[changes * len + slot * 2] = 8 - i;
+                frames[changes * len + slot * 2 + 1] = frame[display][i];
+                changes++;
             }
+        }
 
-            dataLen += 2;
+        if (changes > frameCount) {
+            frameCount = changes;
         }
+    }
 
-        wiringPiSPIDataRW(channel, regData, dataLen);
-        delayMicroseconds(500);
+    if (frameCount == 0) {
+        return false;
     }
+
+    globals.hw->spiWriteBatch(chain->channel, frames, len, frameCount);
+    return true;
 }
 
 /// <summary>
-/// Takes 3 complete data buffers (8 chars each)
-/// and writes them to 3 displays concurrently.
-/// buf1 = left display, buf2 = middle, buf3 = right.
+/// Only changed digits are written so a register corrupted on the
+/// bus would otherwise stay wrong until that digit changes. Each call
+/// rewrites the control registers and one row of digits (the same
+/// digit on every display) from what should be showing, working
+/// through the rows in turn.
 /// </summary>
-void sevensegment::writeSegData3(unsigned char* buf1, unsigned char* buf2, unsigned char* buf3)
+void sevensegment::scrub(displayChain* chain)
 {
-    // Display 0 is the last one (rightmost) in the chain
-    writeSegData(2, buf1);
-    writeSegData(1, buf2);
-    writeSegData(0, buf3);
+    unsigned char frames[(InitRegCount + 1) * MaxChainDisplays * 2];
+    int len = chain->displays * 2;
+    int row = chain->scrubRow;
+
+    for (int slot = 0; slot < chain->displays; slot++) {
+        // Slot 0 is the last display (rightmost) in the chain
+        int display = chain->displays - 1 - slot;
+
+        for (int i = 0; i < InitRegCount; i++) {
+            frames[i * len + slot * 2] = InitRegs[i][0];
+            frames[i * len + slot * 2 + 1] = InitRegs[i][1];
+        }
+
+        // 1 = rightmost digit
+        frames[InitRegCount * len + slot * 2] = 8 - row;
+        frames[InitRegCount * len + slot * 2 + 1] = chain->prevDisplay[display][row];
+    }
+
+    globals.hw->spiWriteBatch(chain->channel, frames, len, InitRegCount + 1);
+
+    chain->scrubRow = (row + 1) % 8;
 }
 
 /// <summary>
-/// Update a display but only write the digits that have changed.
-/// Display must be 0 (right), 1 (middle) or 2 (left)
+/// Writes the latest submitted frame to the displays in a chain.
+/// Only this thread touches the chain's chip select once the
+/// displays have been initialised.
 /// </summary>
-void sevensegment::writeSegData(int display, unsigned char* buf)
+void displayWriter(sevensegment* t, displayChain* chain)
 {
-    unsigned char regData[6];
+    unsigned char frame[MaxChainDisplays][8];
+    long long inputUs;
+
+    if (t->selfTest) {
+        // Leave hyphens showing for a while then clear them.
+        // Any frames submitted meanwhile are kept (latest wins).
+        std::this_thread::sleep_for(std::chrono::milliseconds(SelfTestMs));
+        t->writeRegs(chain, BlankRegs, DigitRegCount);
+    }
+
+    long long nextScrubMs = monotonicMs() + t->scrubMs;
+
+    while (!globals.quit) {
+        bool haveFrame = false;
+        long long waitMs = 100;
 
-    for (int i = 0; i < 8; i++) {
-        if (buf[i] != prevDisplay[display][i]) {
-            prevDisplay[display][i] = buf[i];
+        if (t->scrubMs > 0) {
+            waitMs = nextScrubMs - monotonicMs();
+            if (waitMs < 0) {
+                waitMs = 0;
+            }
+        }
 
-            // Set no-op for all displays
-            regData[0] = 0;
-            regData[2] = 0;
-            regData[4] = 0;
+        {
+            std::unique_lock<std::mutex> lock(chain->frameMutex);
+            chain->frameReady.wait_for(lock, std::chrono::milliseconds(waitMs),
+                [chain] { return chain->framePending || chain->stop || globals.quit; });
 
-            // Replace no-op with digit for required display
-            // 1 = rightmost digit
-            regData[display * 2] = 8 - i;
-            regData[display * 2 + 1] = buf[i];
+            if (chain->stop) {
+                break;
+            }
+
+            if (chain->framePending) {
+                memcpy(frame, chain->pendingFrame, sizeof(frame));
+                inputUs = chain->pendingInputUs;
+                chain->framePending = false;
+                chain->pendingInputUs = 0;
+                haveFrame = true;
+            }
+        }
+
+        if (haveFrame && t->writeSegData(chain, frame) && inputUs != 0) {
+            globals.realTime->addLatency(monotonicUs() - inputUs);
+        }
 
-            // Send the data for single digit, single display
-            wiringPiSPIDataRW(channel, regData, 6);
-            delayMicroseconds(500);
+        if (t->scrubMs > 0 && monotonicMs() >= nextScrubMs) {
+            t->scrub(chain);
+            nextScrubMs = monotonicMs() + t->scrubMs;
         }
     }
 }
@@ -1,23 +1,60 @@
 #ifndef _SEVENSEGMENT_H_
 #define _SEVENSEGMENT_H_
 
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+const int MaxChains = 2;			// CE0 and CE1
+const int MaxChainDisplays = 8;		// Max displays daisy chained on one chip select
+const int MaxDisplays = MaxChains * MaxChainDisplays;
+
+const int DefaultSpiSpeed = 1000000;	// Hz
+const int DefaultScrubMs = 100;
+
+struct displayChain {
+	int channel;
+	int displays;		// Number of daisy chained displays
+	int firstDisplay;	// Index of leftmost display across all chains
+	unsigned char prevDisplay[MaxChainDisplays][8];
+	int scrubRow = 0;	// Next digit row to be rewritten by scrubber
+
+	// Latest-wins mailbox drained by writer thread
+	std::thread* writerThread = NULL;
+	std::mutex frameMutex;
+	std::condition_variable frameReady;
+	unsigned char pendingFrame[MaxChainDisplays][8];
+	bool framePending = false;
+	long long pendingInputUs = 0;	// Time of detent shown by pending frame
+	bool stop = false;				// Set by destructor to end writer thread
+};
+
 class sevensegment
 {
 private:
-	int channel;
-	unsigned char prevDisplay[3][8];	// Max 3 displays daisy chained
+	bool selfTest = true;
+	int spiSpeed = DefaultSpiSpeed;
+	int scrubMs = DefaultScrubMs;
+	int chainCount = 0;
+	int displayCount = 0;
+	displayChain chains[MaxChains];
 
 public:
-	sevensegment(bool initWiringPi, int spiChannel);
+	sevensegment(bool initHardware);
+	~sevensegment();
+	int getDisplayCount();
 	void getSegData(unsigned char* buf, int bufSize, int num, int fixedSize);
 	void getSegDegrees(unsigned char* buf, int bufSize, int numX10);
 	void blankSegData(unsigned char* buf, int bufSize, bool wantMinus);
 	void decimalSegData(unsigned char* buf, int pos);
-	void writeSegData3(unsigned char* buf1, unsigned char* buf2, unsigned char* buf3);
+	void submitFrame(unsigned char* const* bufs, int bufCount, long long inputUs = 0);
 
 private:
-	void writeSegHex(int display, char* hex);
-	void writeSegData(int display, unsigned char* buf);
+	void addChain(int channel, int displays);
+	void writeRegs(displayChain* chain, const unsigned char regs[][2], int regCount);
+	bool writeSegData(displayChain* chain, unsigned char frame[][8]);
+	void scrub(displayChain* chain);
+	friend void displayWriter(sevensegment* t, displayChain* chain);
 };
 
 #endif // _SEVENSEGMENT_H_
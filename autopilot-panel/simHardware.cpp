@@ -0,0 +1,482 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <algorithm>
+#include "settings.h"
+#include "simHardware.h"
+
+const char* SimulationGroup = "Simulation";
+extern const char* SimVarDefs[][2];
+
+// Time between encoder transitions (the watcher samples every 1ms)
+const int SimTransitionMs = 2;
+
+///
+/// Simulated GPIO and SPI for host builds.
+///
+/// Inputs are driven by an optional script file (Simulation/Script
+/// setting). Each line is a time in ms from when the controls are
+/// first read followed by a
+/// command, e.g.
+///
+///   1000 turn 14 15 10 20    Turn encoder on GPIO14/15 10 detents
+///                            clockwise (negative = anti-clockwise)
+///                            with 20ms between detents (optional)
+///   3000 press 4 1500        Hold push on GPIO4 for 1500ms
+///   5000 set 20 0            Set GPIO20 low
+///   0 simvar "Title" "Airbus A320 Neo"
+///   0 simvar "Electrical Main Bus Voltage" 28
+///   6000 simvar "Autopilot Heading Lock Dir" 275
+///                            Set a SimVar (named as in SimVarDefs)
+///
+/// Lines starting with # are ignored.
+///
+/// If the script sets any SimVars they replace the data link, which
+/// is then connected from the start. The values are applied at the
+/// data link rate so update() and render() run the same path as with
+/// MS FS2020. Nothing answers events sent to the sim, so a script
+/// that expects a new value to be confirmed (e.g. a heading change)
+/// must set the SimVar itself.
+///
+/// LED outputs and MAX7219 display registers are captured in memory
+/// along with counts of SPI frames (transfers) and system calls.
+///
+/// The displays can also be decoded to text and written out each time
+/// they (or the LEDs) change by setting Simulation/Output:
+///
+///   Terminal - Print each change to stdout
+///   Trace - Write each change to Simulation/Trace File. The file is
+///           replaced on each run unless Simulation/Trace Append is 1.
+///
+/// Each line shows the time in ms, the SPI transfers and system
+/// calls since the previous line, every display (left to right)
+/// and the GPIO numbers of the LEDs that are on, e.g.
+///
+///   1234 3 1 |250  005|   12000|  -1.5  | 6 19
+///
+/// With SimVars set by the script a trace can be compared against a
+/// known good one to check the digits shown and the SPI traffic for
+/// those inputs.
+///
+
+hardware* createHardware()
+{
+    return new simHardware();
+}
+
+simHardware::simHardware()
+{
+    for (int i = 0; i < SimMaxPins; i++) {
+        // Inputs are pulled up
+        pinLevel[i] = 1;
+        pinOutput[i] = false;
+    }
+
+    memset(segRegister, 0, sizeof(segRegister));
+    memset(chainChips, 0, sizeof(chainChips));
+    *lastSnapshot = '\0';
+}
+
+void simHardware::setup()
+{
+    char scriptFile[256] = "";
+    globals.allSettings->getString(SimulationGroup, "Script", scriptFile);
+    if (*scriptFile != '\0') {
+        loadScript(scriptFile);
+    }
+
+    char outputType[256] = "";
+    globals.allSettings->getString(SimulationGroup, "Output", outputType);
+    if (_stricmp(outputType, "Terminal") == 0) {
+        output = TerminalOutput;
+    }
+    else if (_stricmp(outputType, "Trace") == 0) {
+        char traceName[256] = "";
+        globals.allSettings->getString(SimulationGroup, "Trace File", traceName);
+        bool append = globals.allSettings->getInt(SimulationGroup, "Trace Append") == 1;
+        traceFile = fopen(traceName, append ? "a" : "w");
+        if (!traceFile) {
+            printf("Cannot open simulation trace file %s\n", traceName);
+            exit(1);
+        }
+        output = TraceOutput;
+    }
+    else if (*outputType != '\0') {
+        printf("Bad simulation output type %s (must be Terminal or Trace)\n", outputType);
+        exit(1);
+    }
+    outputStartMs = monotonicMs();
+
+    printf("Using simulated hardware\n");
+}
+
+void simHardware::loadScript(const char* scriptFile)
+{
+    FILE* infile = fopen(scriptFile, "r");
+    if (!infile) {
+        printf("Simulation script %s not found\n", scriptFile);
+        exit(1);
+    }
+
+    char line[256];
+    int lineNum = 0;
+    while (fgets(line, sizeof(line), infile)) {
+        lineNum++;
+
+        long long timeMs;
+        char command[16];
+        int arg[4] = { 0, 0, 0, 20 };
+
+        if (*line == '#' || *line == '\n' || *line == '\r') {
+            continue;
+        }
+
+        int count = sscanf(line, "%lld %15s %d %d %d %d", &timeMs, command, &arg[0], &arg[1], &arg[2], &arg[3]);
+        if (count >= 5 && strcmp(command, "turn") == 0) {
+            // Gray code sequence of Rot1 + Rot2 * 2 (clockwise)
+            static const int sequence[4] = { 1, 0, 2, 3 };
+            int detents = abs(arg[2]);
+            for (int i = 0; i < detents; i++) {
+                for (int j = 0; j < 4; j++) {
+                    int state = arg[2] > 0 ? sequence[j] : sequence[(6 - j) % 4];
+                    addEvent(timeMs, arg[0], state & 1);
+                    addEvent(timeMs, arg[1], (state & 2) >> 1);
+                    timeMs += SimTransitionMs;
+                }
+                timeMs += arg[3];
+            }
+        }
+        else if (count == 4 && strcmp(command, "press") == 0) {
+            addEvent(timeMs, arg[0], 0);
+            addEvent(timeMs + arg[1], arg[0], 1);
+        }
+        else if (count == 4 && strcmp(command, "set") == 0) {
+            addEvent(timeMs, arg[0], arg[1]);
+        }
+        else if (count >= 2 && strcmp(command, "simvar") == 0) {
+            addSimVarEvent(timeMs, line, lineNum);
+        }
+        else {
+            printf("Bad simulation script line %d: %s", lineNum, line);
+            exit(1);
+        }
+    }
+
+    fclose(infile);
+
+    std::stable_sort(events.begin(), events.end(),
+        [](const simPinEvent& a, const simPinEvent& b) { return a.timeMs < b.timeMs; });
+    std::stable_sort(simVarEvents.begin(), simVarEvents.end(),
+        [](const simVarEvent& a, const simVarEvent& b) { return a.timeMs < b.timeMs; });
+
+    printf("Loaded %d simulated pin changes from %s\n", (int)events.size(), scriptFile);
+    if (!simVarEvents.empty()) {
+        printf("Loaded %d simulated SimVar changes from %s\n", (int)simVarEvents.size(), scriptFile);
+    }
+}
+
+/// <summary>
+/// SimVars are laid out in the same order as SimVarDefs, after the
+/// connected flag, so the offset of a named SimVar can be found by
+/// adding up the sizes of the ones before it.
+/// </summary>
+void simHardware::addSimVarEvent(long long timeMs, const char* line, int lineNum)
+{
+    const char* name = strchr(line, '"');
+    const char* nameEnd = name ? strchr(name + 1, '"') : NULL;
+    if (!nameEnd) {
+        printf("Bad simulation script line %d: %s", lineNum, line);
+        exit(1);
+    }
+    name++;
+    int nameLen = (int)(nameEnd - name);
+
+    simVarEvent event;
+    memset(&event, 0, sizeof(event));
+    event.timeMs = timeMs;
+    event.offset = -1;
+
+    int offset = offsetof(SimVars, connected) + sizeof(double);
+    for (int i = 0; SimVarDefs[i][0] != NULL; i++) {
+        bool isString = strcmp(SimVarDefs[i][1], "string32") == 0;
+        if ((int)strlen(SimVarDefs[i][0]) == nameLen && strncmp(SimVarDefs[i][0], name, nameLen) == 0) {
+            event.offset = offset;
+            event.isString = isString;
+            break;
+        }
+        offset += isString ? 32 : sizeof(double);
+    }
+
+    if (event.offset == -1 || event.offset >= (int)sizeof(SimVars)) {
+        printf("Unknown SimVar on simulation script line %d: %s", lineNum, line);
+        exit(1);
+    }
+
+    const char* value = nameEnd + 1;
+    while (*value == ' ' || *value == '\t') {
+        value++;
+    }
+
+    if (event.isString) {
+        const char* valueEnd = *value == '"' ? strchr(value + 1, '"') : NULL;
+        if (!valueEnd) {
+            printf("Bad simulation script line %d: %s", lineNum, line);
+            exit(1);
+        }
+        int valueLen = std::min((int)(valueEnd - value - 1), (int)sizeof(event.text) - 1);
+        memcpy(event.text, value + 1, valueLen);
+    }
+    else {
+        char* valueEnd;
+        event.value = strtod(value, &valueEnd);
+        if (valueEnd == value) {
+            printf("Bad simulation script line %d: %s", lineNum, line);
+            exit(1);
+        }
+    }
+
+    simVarEvents.push_back(event);
+}
+
+bool simHardware::simulatesSimVars()
+{
+    return !simVarEvents.empty();
+}
+
+/// <summary>
+/// Only called by the data link thread. Script times are from when
+/// the controls are first read so nothing is applied before then.
+/// </summary>
+bool simHardware::updateSimVars(SimVars* simVars)
+{
+    long long start = startMs.load();
+    if (start == 0) {
+        return false;
+    }
+
+    long long nowMs = monotonicMs() - start;
+    bool titleChanged = false;
+
+    while (nextSimVarEvent < simVarEvents.size() && simVarEvents[nextSimVarEvent].timeMs <= nowMs) {
+        const simVarEvent* event = &simVarEvents[nextSimVarEvent];
+        char* valuePtr = (char*)simVars + event->offset;
+        if (event->isString) {
+            if (event->offset == offsetof(SimVars, aircraft) && strcmp(valuePtr, event->text) != 0) {
+                titleChanged = true;
+            }
+            strcpy(valuePtr, event->text);
+        }
+        else {
+            *(double*)valuePtr = event->value;
+        }
+        nextSimVarEvent++;
+    }
+
+    return titleChanged;
+}
+
+void simHardware::addEvent(long long timeMs, int pin, int level)
+{
+    if (pin < 0 || pin >= SimMaxPins) {
+        printf("Bad simulated pin: %d\n", pin);
+        exit(1);
+    }
+
+    simPinEvent event = { timeMs, pin, level };
+    events.push_back(event);
+}
+
+void simHardware::initPin(int pin, bool isInput)
+{
+    if (pin >= 0 && pin < SimMaxPins) {
+        pinOutput[pin] = !isInput;
+    }
+}
+
+/// <summary>
+/// Only called by the watcher thread so it is safe to play
+/// the script forward from here.
+/// </summary>
+int simHardware::readPin(int pin)
+{
+    if (startMs == 0) {
+        // Script times are from when the controls are first read
+        startMs = monotonicMs();
+    }
+
+    long long nowMs = monotonicMs() - startMs;
+
+    while (nextEvent < events.size() && events[nextEvent].timeMs <= nowMs) {
+        pinLevel[events[nextEvent].pin] = events[nextEvent].level;
+        nextEvent++;
+    }
+
+    return pinLevel[pin];
+}
+
+void simHardware::writePin(int pin, int value)
+{
+    if (pin >= 0 && pin < SimMaxPins) {
+        std::lock_guard<std::mutex> lock(outputMutex);
+        pinLevel[pin] = value;
+        writeOutput();
+    }
+}
+
+int simHardware::getPin(int pin)
+{
+    return pinLevel[pin];
+}
+
+void simHardware::spiSetup(int channel, int speed)
+{
+    printf("Simulated SPI channel %d at %d Hz\n", channel, speed);
+}
+
+void simHardware::spiWrite(int channel, unsigned char* data, int len)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+
+    spiCalls++;
+    captureFrame(channel, data, len);
+    writeOutput();
+}
+
+void simHardware::spiWriteBatch(int channel, unsigned char* data, int len, int count)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+
+    if (count > 0) {
+        spiCalls++;
+    }
+
+    for (int i = 0; i < count; i++) {
+        captureFrame(channel, &data[i * len], len);
+    }
+
+    writeOutput();
+}
+
+/// <summary>
+/// Capture a frame written to daisy-chained MAX7219s. The first
+/// register/value pair shifts through to the last chip in the chain (display 0).
+/// Register 0 is a no-op.
+/// </summary>
+void simHardware::captureFrame(int channel, unsigned char* data, int len)
+{
+    spiTransfers++;
+
+    if (channel < 0 || channel >= SimMaxChannels) {
+        return;
+    }
+
+    if (len / 2 > chainChips[channel]) {
+        chainChips[channel] = std::min(len / 2, SimMaxChips);
+    }
+
+    for (int chip = 0; chip < len / 2 && chip < SimMaxChips; chip++) {
+        int reg = data[chip * 2] & 0x0f;
+        if (reg != 0) {
+            segRegister[channel][chip][reg] = data[chip * 2 + 1];
+        }
+    }
+}
+
+/// <summary>
+/// Number of displays seen so far across all channels.
+/// </summary>
+int simHardware::getDisplayCount()
+{
+    int count = 0;
+    for (int channel = 0; channel < SimMaxChannels; channel++) {
+        count += chainChips[channel];
+    }
+
+    return count;
+}
+
+/// <summary>
+/// Decodes the digit registers of a display (numbered left to right
+/// across CE0 then CE1) to text. Assumes Code B decode is on. A
+/// decimal point follows the digit it belongs to.
+/// </summary>
+void simHardware::getDisplayText(int display, char* text)
+{
+    static const char codeB[16] = {
+        '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '-', 'E', 'H', 'L', 'P', ' '
+    };
+
+    int channel = 0;
+    while (channel < SimMaxChannels - 1 && display >= chainChips[channel]) {
+        display -= chainChips[channel];
+        channel++;
+    }
+
+    *text = '\0';
+    if (display >= chainChips[channel]) {
+        return;
+    }
+
+    // Chip 0 is the last (rightmost) display in the chain
+    int chip = chainChips[channel] - 1 - display;
+    int pos = 0;
+
+    // Register 8 is the leftmost digit
+    for (int reg = 8; reg >= 1; reg--) {
+        unsigned char val = segRegister[channel][chip][reg];
+        text[pos++] = codeB[val & 0x0f];
+        if (val & 0x80) {
+            text[pos++] = '.';
+        }
+    }
+    text[pos] = '\0';
+}
+
+/// <summary>
+/// Writes the decoded displays and LEDs if they have changed.
+/// Called with outputMutex held.
+/// </summary>
+void simHardware::writeOutput()
+{
+    if (output == NoOutput) {
+        return;
+    }
+
+    char snapshot[1024] = "|";
+    char text[SimMaxText];
+    int displayCount = getDisplayCount();
+
+    for (int display = 0; display < displayCount; display++) {
+        getDisplayText(display, text);
+        strcat(snapshot, text);
+        strcat(snapshot, "|");
+    }
+
+    for (int pin = 0; pin < SimMaxPins; pin++) {
+        if (pinOutput[pin] && pinLevel[pin] == 1) {
+            sprintf(&snapshot[strlen(snapshot)], " %d", pin);
+        }
+    }
+
+    if (strcmp(snapshot, lastSnapshot) == 0) {
+        return;
+    }
+    strcpy(lastSnapshot, snapshot);
+
+    long transfers = spiTransfers - lastTransfers;
+    long calls = spiCalls - lastCalls;
+    lastTransfers = spiTransfers;
+    lastCalls = spiCalls;
+
+    long long nowMs = monotonicMs() - outputStartMs;
+
+    if (output == TerminalOutput) {
+        printf("%lld %ld %ld %s\n", nowMs, transfers, calls, snapshot);
+        fflush(stdout);
+    }
+    else {
+        fprintf(traceFile, "%lld %ld %ld %s\n", nowMs, transfers, calls, snapshot);
+        fflush(traceFile);
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef _SIMHARDWARE_H_
+#define _SIMHARDWARE_H_
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <stdio.h>
+#include "hardware.h"
+#include "simvarDefs.h"
+
+const int SimMaxPins = 64;
+const int SimMaxChannels = 2;
+const int SimMaxChips = 8;
+const int SimMaxText = 17;      // 8 digits, 8 decimal points and terminator
+
+enum simOutput {
+    NoOutput,
+    TerminalOutput,
+    TraceOutput
+};
+
+struct simPinEvent {
+    long long timeMs;
+    int pin;
+    int level;
+};
+
+struct simVarEvent {
+    long long timeMs;
+    int offset;         // Offset of the value in SimVars
+    bool isString;
+    double value;
+    char text[32];
+};
+
+class simHardware : public hardware
+{
+private:
+    std::vector<simPinEvent> events;
+    size_t nextEvent = 0;
+    std::atomic<long long> startMs{ 0 };
+
+    // Scripted SimVars played forward by the data link thread
+    std::vector<simVarEvent> simVarEvents;
+    size_t nextSimVarEvent = 0;
+    int pinLevel[SimMaxPins];
+    bool pinOutput[SimMaxPins];
+
+    // Decoded displays and LEDs written whenever they change
+    std::mutex outputMutex;
+    simOutput output = NoOutput;
+    FILE* traceFile = NULL;
+    long long outputStartMs = 0;
+    int chainChips[SimMaxChannels];
+    char lastSnapshot[1024];
+    long lastTransfers = 0;
+    long lastCalls = 0;
+
+public:
+    unsigned char segRegister[SimMaxChannels][SimMaxChips][16];
+    // Chains on different channels are written concurrently
+    std::atomic<long> spiTransfers{ 0 };
+    std::atomic<long> spiCalls{ 0 };
+
+public:
+    simHardware();
+    void setup();
+    void initPin(int pin, bool isInput);
+    int readPin(int pin);
+    void writePin(int pin, int value);
+    void spiSetup(int channel, int speed);
+    void spiWrite(int channel, unsigned char* data, int len);
+    void spiWriteBatch(int channel, unsigned char* data, int len, int count);
+    int getPin(int pin);
+    int getDisplayCount();
+    void getDisplayText(int display, char* text);
+    bool simulatesSimVars();
+    bool updateSimVars(SimVars* simVars);
+
+private:
+    void loadScript(const char* scriptFile);
+    void addEvent(long long timeMs, int pin, int level);
+    void addSimVarEvent(long long timeMs, const char* line, int lineNum);
+    void captureFrame(int channel, unsigned char* data, int len);
+    void writeOutput();
+};
+
+#endif // _SIMHARDWARE_H_
@@ -2,7 +2,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include "settings.h"
+#include "realtime.h"
 #include "simvars.h"
+#include "aircraftid.h"
+#include "switchbox.h"
+#include "hardware.h"
 
 const char *DataLinkGroup = "Data Link";
 char dataLinkHost[64];
@@ -13,22 +17,19 @@ int dataSize;
 Request request;
 char deltaData[8192];
 int nextFull = 0;
+bool titleChanged = true;
 
 void dataLink(simvars*);
-void identifyAircraft(char* aircraft);
-void receiveDelta(char* deltaData, int deltaSize, char* simVarsPtr);
+void simulatedDataLink(simvars*);
+bool receiveDelta(char* deltaData, int deltaSize, char* simVarsPtr);
 
 simvars::simvars()
 {
-    globals.allSettings->getString(DataLinkGroup, "Host", dataLinkHost);
-    if (dataLinkHost == NULL) {
-        strcpy(dataLinkHost, "127.0.0.1");
+    if (!readSettings(dataLinkHost, &dataLinkPort, &globals.dataRateFps)) {
+        exit(1);
     }
 
-    dataLinkPort = globals.allSettings->getInt(DataLinkGroup, "Port");
-    if (dataLinkPort == INT_MIN) {
-        dataLinkPort = 52020;
-    }
+    aircraftId = new aircraftid();
 
     // Start data link thread
     dataLinkThread = new std::thread(dataLink, this);
@@ -42,12 +43,95 @@ simvars::~simvars()
     }
 }
 
+/// <summary>
+/// Reads the data link endpoint and rate (updates per second).
+/// Returns false (after showing the error) if they are invalid.
+/// </summary>
+bool simvars::readSettings(char* host, int* port, long* rateFps)
+{
+    *host = '\0';
+    globals.allSettings->getString(DataLinkGroup, "Host", host);
+    if (*host == '\0') {
+        strcpy(host, "127.0.0.1");
+    }
+
+    *port = globals.allSettings->getInt(DataLinkGroup, "Port");
+    if (*port == INT_MIN) {
+        *port = 52020;
+    }
+
+    int rate = globals.allSettings->getInt(DataLinkGroup, "Rate");
+    if (rate != INT_MIN) {
+        if (rate < 1 || rate > 100) {
+            printf("Invalid data link rate %d (must be 1 to 100)\n", rate);
+            return false;
+        }
+        *rateFps = rate;
+    }
+
+    sockaddr_in addr;
+    if (inet_pton(AF_INET, host, &addr.sin_addr) <= 0) {
+        printf("DataLink: Invalid server address: %s\n", host);
+        return false;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Returns false (after showing the error) if the data link
+/// settings in the current settings are invalid.
+/// </summary>
+bool simvars::checkSettings()
+{
+    char host[64];
+    int port;
+    long rateFps = globals.dataRateFps;
+
+    return readSettings(host, &port, &rateFps);
+}
+
+/// <summary>
+/// Called when the settings file has changed. The rate changes
+/// straight away. A new endpoint is picked up by the data link
+/// thread on its next poll and the connection is re-established.
+/// </summary>
+void simvars::reloadSettings()
+{
+    char host[64];
+    int port;
+    long rateFps = globals.dataRateFps;
+
+    if (!readSettings(host, &port, &rateFps)) {
+        printf("Keeping current data link settings\n");
+        return;
+    }
+
+    globals.dataRateFps = rateFps;
+
+    {
+        std::lock_guard<std::mutex> lock(endpointMutex);
+        strcpy(pendingHost, host);
+        pendingPort = port;
+    }
+    endpointChanged = true;
+
+    // Writes are made from this thread
+    if (writeSockfd != INVALID_SOCKET) {
+        writeAddr.sin_port = htons(port);
+        inet_pton(AF_INET, host, &writeAddr.sin_addr);
+    }
+
+    printf("Reloaded data link settings\n");
+    fflush(stdout);
+}
+
 /// <summary>
 /// Write event to Flight Sim with optional data value
 /// </summary>
 void simvars::write(EVENT_ID eventId, double value)
 {
-    if (!globals.dataLinked) {
+    if (!globals.dataLinked || globals.hw->simulatesSimVars()) {
         return;
     }
 
@@ -92,8 +176,9 @@ void resetConnection(simvars* thisPtr)
 
     globals.dataLinked = false;
     globals.connected = false;
-    globals.aircraft = NO_AIRCRAFT;
-    strcpy(globals.lastAircraft, "");
+    publishAircraft(NO_AIRCRAFT, -1, VOLTS_ELECTRICS);
+    titleChanged = true;
+    globals.switchBox->reset();
 
     printf("Waiting for Data Link at %s:%d\n", dataLinkHost, dataLinkPort);
     fflush(stdout);
@@ -126,7 +211,13 @@ void processData(simvars* thisPtr)
         prevConnected = globals.connected;
     }
 
-    identifyAircraft(thisPtr->simVars.aircraft);
+    globals.switchBox->update(&thisPtr->simVars);
+
+    // Only need to identify the aircraft when its title changes
+    if (titleChanged) {
+        titleChanged = false;
+        thisPtr->aircraftId->identify(thisPtr->simVars.aircraft);
+    }
 }
 
 /// <summary>
@@ -142,6 +233,13 @@ void dataLink(simvars* thisPtr)
     int bytes;
     int selFail = 0;
 
+    globals.realTime->configureThread("Data Link");
+
+    if (globals.hw->simulatesSimVars()) {
+        simulatedDataLink(thisPtr);
+        return;
+    }
+
     // Create a UDP socket
     SOCKET sockfd;
     if ((sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == INVALID_SOCKET) {
@@ -164,6 +262,18 @@ void dataLink(simvars* thisPtr)
     resetConnection(thisPtr);
 
     while (!globals.quit) {
+        if (thisPtr->endpointChanged) {
+            thisPtr->endpointChanged = false;
+            {
+                std::lock_guard<std::mutex> lock(thisPtr->endpointMutex);
+                strcpy(dataLinkHost, thisPtr->pendingHost);
+                dataLinkPort = thisPtr->pendingPort;
+            }
+            addr.sin_port = htons(dataLinkPort);
+            inet_pton(AF_INET, dataLinkHost, &addr.sin_addr);
+            resetConnection(thisPtr);
+        }
+
         // Poll instrument data link
         //if (nextFull > 0) {
         //    nextFull--;
@@ -197,11 +307,17 @@ void dataLink(simvars* thisPtr)
                 else if (bytes > 0) {
                     if (bytes == dataSize) {
                         // Full data received
+                        const int titleOffset = offsetof(SimVars, aircraft);
+                        if (memcmp(&deltaData[titleOffset], thisPtr->simVars.aircraft, sizeof(thisPtr->simVars.aircraft)) != 0) {
+                            titleChanged = true;
+                        }
                         memcpy((char*)&thisPtr->simVars, deltaData, dataSize);
                     }
                     else {
                         // Delta received
-                        receiveDelta(deltaData, bytes, (char*)&thisPtr->simVars);
+                        if (receiveDelta(deltaData, bytes, (char*)&thisPtr->simVars)) {
+                            titleChanged = true;
+                        }
                     }
 
                     processData(thisPtr);
@@ -231,3 +347,23 @@ void dataLink(simvars* thisPtr)
 
     closesocket(sockfd);
 }
+
+/// <summary>
+/// Host builds whose simulation script sets SimVars use those
+/// values instead of the data link (see simHardware).
+/// </summary>
+void simulatedDataLink(simvars* thisPtr)
+{
+    resetConnection(thisPtr);
+    thisPtr->simVars.connected = 1;
+
+    while (!globals.quit) {
+        if (globals.hw->updateSimVars(&thisPtr->simVars)) {
+            titleChanged = true;
+        }
+
+        processData(thisPtr);
+
+        usleep(1000000 / globals.dataRateFps);
+    }
+}
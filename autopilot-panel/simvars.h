@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <thread>
+#include <mutex>
+#include <atomic>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -17,21 +19,37 @@ typedef int SOCKET;
 
 extern globalVars globals;
 
+class aircraftid;
+
 class simvars {
 public:
     SimVars simVars;
 
 private:
     std::thread* dataLinkThread = NULL;
+    aircraftid* aircraftId = NULL;
 
     SOCKET writeSockfd = INVALID_SOCKET;
     sockaddr_in writeAddr;
     Request writeRequest;
 
+    // Reloaded endpoint picked up by the data link thread
+    std::mutex endpointMutex;
+    char pendingHost[64];
+    int pendingPort;
+    std::atomic<bool> endpointChanged{ false };
+
 public:
     simvars();
     ~simvars();
     void write(EVENT_ID eventId, double value = 0);
+    bool checkSettings();
+    void reloadSettings();
+
+private:
+    bool readSettings(char* host, int* port, long* rateFps);
+    friend void dataLink(simvars*);
+    friend void processData(simvars*);
 };
 
 #endif // _SIMVARS_H_
@@ -0,0 +1,222 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "settings.h"
+#include "realtime.h"
+#include "simvars.h"
+#include "switchbox.h"
+
+const char* SwitchBoxGroup = "SwitchBox";
+
+void switchBoxListener(switchbox*);
+
+///
+/// Turns SwitchBox knobs and buttons into input events for the
+/// controls they are mapped to. Buttons use the same odd (released)
+/// / even (pressed) counts as GPIO pushes.
+///
+/// Counts normally arrive as SimVars from the data link. If a
+/// "SwitchBox": { "Port": n } setting is present SwitchBox can also
+/// send them straight to the panel as SwitchBoxPackets over UDP,
+/// which saves the round trip through the sim. Relayed counts are
+/// then ignored for any input that has been received directly as
+/// they can only repeat (or lag behind) the direct ones. Counts are
+/// absolute so a lost direct packet is made up by the next one.
+///
+
+switchbox::switchbox()
+{
+    directPort = globals.allSettings->getInt(SwitchBoxGroup, "Port");
+    if (directPort == INT_MIN) {
+        directPort = 0;
+    }
+
+    if (directPort < 0 || directPort > 65535) {
+        printf("Invalid SwitchBox port %d\n", directPort);
+        exit(1);
+    }
+
+    if (directPort != 0) {
+        listenerThread = new std::thread(switchBoxListener, this);
+    }
+}
+
+switchbox::~switchbox()
+{
+    if (listenerThread) {
+        // Wait for thread to exit
+        listenerThread->join();
+    }
+}
+
+/// <summary>
+/// Controls are mapped after the data link (and listener) threads
+/// have started so this is done under the lock.
+/// </summary>
+void switchbox::mapEncoder(int encoder, int control)
+{
+    std::lock_guard<std::mutex> lock(inputMutex);
+    encoders[encoder].control = control;
+}
+
+void switchbox::mapButton(int button, int control)
+{
+    std::lock_guard<std::mutex> lock(inputMutex);
+    buttons[button].control = control;
+}
+
+/// <summary>
+/// Called by the data link when the connection is lost so
+/// the counts are picked up again without generating input.
+/// Inputs that have been received directly keep their counts
+/// as the direct channel is unaffected.
+/// </summary>
+void switchbox::reset()
+{
+    std::lock_guard<std::mutex> lock(inputMutex);
+
+    for (int i = 0; i < SwitchBoxEncoders; i++) {
+        encoders[i].known = encoders[i].known && encoders[i].direct;
+    }
+
+    for (int i = 0; i < SwitchBoxButtons; i++) {
+        buttons[i].known = buttons[i].known && buttons[i].direct;
+    }
+}
+
+/// <summary>
+/// Called by the data link whenever new data is received.
+/// </summary>
+void switchbox::update(SimVars* simVars)
+{
+    std::lock_guard<std::mutex> lock(inputMutex);
+    long long nowUs = monotonicUs();
+
+    for (int i = 0; i < SwitchBoxEncoders; i++) {
+        encoderCount(&encoders[i], simVars->sbEncoder[i], false, nowUs);
+    }
+
+    for (int i = 0; i < SwitchBoxButtons; i++) {
+        buttonCount(&buttons[i], simVars->sbButton[i], false, nowUs);
+    }
+}
+
+/// <summary>
+/// Returns false if a count should be ignored.
+/// </summary>
+bool switchbox::wanted(switchBoxInput* input, bool direct)
+{
+    if (direct) {
+        input->direct = true;
+        return true;
+    }
+
+    // Relayed counts are only used for inputs with no direct traffic
+    return !input->direct;
+}
+
+/// <summary>
+/// Posts a rotation for any change in count. The first count
+/// seen is only remembered.
+/// </summary>
+void switchbox::encoderCount(switchBoxInput* input, int val, bool direct, long long nowUs)
+{
+    if (!wanted(input, direct)) {
+        return;
+    }
+
+    if (input->known && val != input->prev && input->control != -1) {
+        globals.inputQueue->post({ input->control, RotateAction, SwitchBoxInput, val - input->prev, 1, nowUs });
+    }
+
+    input->prev = val;
+    input->known = true;
+}
+
+/// <summary>
+/// Posts a press or release for any change in count. A count of 0
+/// means SwitchBox hasn't sent anything yet.
+/// </summary>
+void switchbox::buttonCount(switchBoxInput* input, int val, bool direct, long long nowUs)
+{
+    if (!wanted(input, direct)) {
+        return;
+    }
+
+    if (input->known && input->prev != 0 && val != input->prev && input->control != -1) {
+        inputAction action = ReleaseAction;
+        if (input->prev % 2 == 1) {
+            action = PressAction;
+        }
+        globals.inputQueue->post({ input->control, action, SwitchBoxInput, val, 1, nowUs });
+    }
+
+    input->prev = val;
+    input->known = true;
+}
+
+/// <summary>
+/// A separate thread receives packets sent directly by SwitchBox.
+/// </summary>
+void switchBoxListener(switchbox* thisPtr)
+{
+    timeval timeout;
+    SwitchBoxPacket packet;
+
+    globals.realTime->configureThread("SwitchBox");
+
+    // Create a UDP socket
+    SOCKET sockfd;
+    if ((sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == INVALID_SOCKET) {
+        printf("SwitchBox: Failed to create UDP socket\n");
+        exit(1);
+    }
+
+    int opt = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(thisPtr->directPort);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    if (bind(sockfd, (SOCKADDR*)&addr, sizeof(addr)) == SOCKET_ERROR) {
+        printf("SwitchBox: Failed to listen on port %d\n", thisPtr->directPort);
+        exit(1);
+    }
+
+    printf("Listening for SwitchBox on port %d\n", thisPtr->directPort);
+    fflush(stdout);
+
+    while (!globals.quit) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(sockfd, &fds);
+
+        // Wake up regularly to check for quit
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 500000;
+
+        if (select(FD_SETSIZE, &fds, 0, 0, &timeout) <= 0) {
+            continue;
+        }
+
+        int bytes = recv(sockfd, (char*)&packet, sizeof(packet), 0);
+        if (bytes != sizeof(packet) || packet.magic[0] != 'S' || packet.magic[1] != 'B') {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(thisPtr->inputMutex);
+        long long nowUs = monotonicUs();
+
+        if (packet.kind == SwitchBoxEncoder && packet.index < SwitchBoxEncoders) {
+            thisPtr->encoderCount(&thisPtr->encoders[packet.index], packet.count, true, nowUs);
+        }
+        else if (packet.kind == SwitchBoxButton && packet.index < SwitchBoxButtons) {
+            thisPtr->buttonCount(&thisPtr->buttons[packet.index], packet.count, true, nowUs);
+        }
+    }
+
+    closesocket(sockfd);
+}
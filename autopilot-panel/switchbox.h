@@ -0,0 +1,58 @@
+#ifndef _SWITCHBOX_H_
+#define _SWITCHBOX_H_
+
+#include <thread>
+#include <mutex>
+#include "simvarDefs.h"
+#include "inputqueue.h"
+
+const int SwitchBoxEncoders = 4;
+const int SwitchBoxButtons = 7;
+
+enum switchBoxKind {
+    SwitchBoxEncoder,
+    SwitchBoxButton
+};
+
+// Packet sent directly by SwitchBox (little endian). Count is the
+// same running count as the sbEncoder/sbButton SimVar so a lost or
+// repeated packet does no harm.
+struct SwitchBoxPacket {
+    char magic[2];          // "SB"
+    unsigned char kind;     // switchBoxKind
+    unsigned char index;    // Encoder or button number
+    int count;
+};
+
+struct switchBoxInput {
+    int control = -1;
+    int prev = 0;
+    bool known = false;
+    bool direct = false;    // Has been received directly
+};
+
+class switchbox
+{
+private:
+    std::mutex inputMutex;
+    switchBoxInput encoders[SwitchBoxEncoders];
+    switchBoxInput buttons[SwitchBoxButtons];
+    int directPort = 0;
+    std::thread* listenerThread = NULL;
+
+public:
+    switchbox();
+    ~switchbox();
+    void mapEncoder(int encoder, int control);
+    void mapButton(int button, int control);
+    void update(SimVars* simVars);
+    void reset();
+
+private:
+    bool wanted(switchBoxInput* input, bool direct);
+    void encoderCount(switchBoxInput* input, int val, bool direct, long long nowUs);
+    void buttonCount(switchBoxInput* input, int val, bool direct, long long nowUs);
+    friend void switchBoxListener(switchbox*);
+};
+
+#endif // _SWITCHBOX_H_
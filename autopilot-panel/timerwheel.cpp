@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "timerwheel.h"
+
+///
+/// Hashed timer wheel with 1 ms ticks. Each timer is linked into the
+/// slot for its due tick so starting, restarting and cancelling are
+/// O(1) and advancing only looks at the slots for the ticks that have
+/// passed. Timers more than one turn of the wheel away stay in their
+/// slot until their due time comes round.
+///
+/// Only used by the render thread so there is no locking.
+///
+
+timerwheel::timerwheel()
+{
+    for (int i = 0; i < TimerWheelSlots; i++) {
+        slots[i] = NULL;
+    }
+
+    currentMs = monotonicUs() / 1000;
+}
+
+/// <summary>
+/// Starts the timer or, if it is already running, restarts it.
+/// </summary>
+void timerwheel::start(timer* t, int delayMs)
+{
+    cancel(t);
+
+    // Can't be due on a tick that has already been processed
+    if (delayMs < 1) {
+        delayMs = 1;
+    }
+
+    t->dueMs = monotonicUs() / 1000 + delayMs;
+    if (t->dueMs <= currentMs) {
+        t->dueMs = currentMs + 1;
+    }
+
+    t->slot = t->dueMs & (TimerWheelSlots - 1);
+    t->prev = NULL;
+    t->next = slots[t->slot];
+    if (t->next) {
+        t->next->prev = t;
+    }
+    slots[t->slot] = t;
+}
+
+void timerwheel::cancel(timer* t)
+{
+    if (!t->pending()) {
+        return;
+    }
+
+    if (t->prev) {
+        t->prev->next = t->next;
+    }
+    else {
+        slots[t->slot] = t->next;
+    }
+
+    if (t->next) {
+        t->next->prev = t->prev;
+    }
+
+    t->slot = -1;
+    t->prev = NULL;
+    t->next = NULL;
+}
+
+/// <summary>
+/// Fires every timer that is now due. Called by the main loop.
+/// </summary>
+void timerwheel::advance()
+{
+    long long nowMs = monotonicUs() / 1000;
+
+    while (currentMs < nowMs) {
+        currentMs++;
+        int slot = currentMs & (TimerWheelSlots - 1);
+
+        timer* t = slots[slot];
+        while (t) {
+            if (t->dueMs > currentMs) {
+                // Due on a later turn of the wheel
+                t = t->next;
+                continue;
+            }
+
+            cancel(t);
+            if (t->expired) {
+                t->expired();
+            }
+
+            // Expiry may have started or cancelled other timers
+            t = slots[slot];
+        }
+    }
+}
+
+/// <summary>
+/// Returns the time the next timer is due or limitUs if
+/// none are due before then.
+/// </summary>
+long long timerwheel::nextDueUs(long long limitUs)
+{
+    long long limitMs = limitUs / 1000;
+    if (limitMs > currentMs + TimerWheelSlots) {
+        limitMs = currentMs + TimerWheelSlots;
+    }
+
+    for (long long tick = currentMs + 1; tick <= limitMs; tick++) {
+        for (timer* t = slots[tick & (TimerWheelSlots - 1)]; t; t = t->next) {
+            if (t->dueMs == tick) {
+                return tick * 1000;
+            }
+        }
+    }
+
+    return limitUs;
+}
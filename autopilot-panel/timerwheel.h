@@ -0,0 +1,37 @@
+#ifndef _TIMERWHEEL_H_
+#define _TIMERWHEEL_H_
+
+#include <functional>
+#include "globals.h"
+
+extern globalVars globals;
+
+const int TimerWheelSlots = 256;    // Must be a power of 2
+
+// A timeout owned by whoever uses it. Set expired once and
+// then (re)start it as often as needed.
+struct timer {
+    std::function<void()> expired;
+    long long dueMs = 0;
+    int slot = -1;      // -1 = not running
+    timer* prev = NULL;
+    timer* next = NULL;
+
+    bool pending() const { return slot != -1; }
+};
+
+class timerwheel
+{
+private:
+    timer* slots[TimerWheelSlots];
+    long long currentMs;    // Last tick processed
+
+public:
+    timerwheel();
+    void start(timer* t, int delayMs);
+    void cancel(timer* t);
+    void advance();
+    long long nextDueUs(long long limitUs);
+};
+
+#endif // _TIMERWHEEL_H_
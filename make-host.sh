@@ -0,0 +1,23 @@
+echo Building autopilot-panel-host with simulated hardware
+cd autopilot-panel
+g++ -g -O2 -o autopilot-panel-host -I . \
+    settings.cpp \
+    simvarDefs.cpp \
+    simvars.cpp \
+    globals.cpp \
+    gpioctrl.cpp \
+    sevensegment.cpp \
+    realtime.cpp \
+    simHardware.cpp \
+    displaylayout.cpp \
+    hotreload.cpp \
+    aircraftprofile.cpp \
+    aircraftid.cpp \
+    inputqueue.cpp \
+    switchbox.cpp \
+    timerwheel.cpp \
+    setpoint.cpp \
+    autopilot.cpp \
+    autopilot-panel.cpp \
+    -lpthread || exit
+echo Done
@@ -7,6 +7,16 @@ g++ -o autopilot-panel -I . \
     globals.cpp \
     gpioctrl.cpp \
     sevensegment.cpp \
+    realtime.cpp \
+    piHardware.cpp \
+    displaylayout.cpp \
+    hotreload.cpp \
+    aircraftprofile.cpp \
+    aircraftid.cpp \
+    inputqueue.cpp \
+    switchbox.cpp \
+    timerwheel.cpp \
+    setpoint.cpp \
     autopilot.cpp \
     autopilot-panel.cpp \
     -lwiringPi -lpthread || exit